@@ -23,9 +23,14 @@
 #include "average.h"
 #include "spectrum_marker.hpp"
 #include "marker_controller.h"
+#include "frame_ring.hpp"
 
 #include <qwt_symbol.h>
+#include <qwt_series_data.h>
 #include <boost/make_shared.hpp>
+#include <volk/volk.h>
+#include <cmath>
+#include <string.h>
 
 using namespace adiscope;
 
@@ -61,14 +66,69 @@ protected:
   }
 };
 
+/*
+ * Curve samples made of the shared frequency axis and the single precision
+ * levels of one channel, so the levels never need a double copy.
+ */
+class FftCurveData: public QwtSeriesData<QPointF>
+{
+public:
+	FftCurveData(const double *x, const float *y, size_t size) :
+		m_x(x), m_y(y), m_size(size),
+		m_rect(1.0, 1.0, -2.0, -2.0)
+	{
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	QPointF sample(size_t i) const
+	{
+		return QPointF(m_x[i], m_y[i]);
+	}
+
+	QRectF boundingRect() const
+	{
+		// Cached like QwtCPointerData does it
+		if (m_rect.width() < 0.0)
+			m_rect = qwtBoundingRect(*this);
+
+		return m_rect;
+	}
+
+private:
+	const double *m_x;
+	const float *m_y;
+	size_t m_size;
+	mutable QRectF m_rect;
+};
+
+static void copy_level(float *dst, const Frame *frame, unsigned int chn,
+		size_t offset, size_t count)
+{
+	if (frame->is_float)
+		memcpy(dst, frame->fdata[chn] + offset, count * sizeof(float));
+	else
+		volk_64f_convert_32f(dst, frame->data[chn] + offset, count);
+}
+
 FftDisplayPlot::FftDisplayPlot(int nplots, QWidget *parent) :
 	DisplayPlot(nplots, parent),
 	d_start_frequency(0),
 	d_stop_frequency(1000),
 	d_sampl_rate(1),
 	d_preset_sampl_rate(d_sampl_rate),
+	d_zoom(false),
+	d_preset_zoom(false),
+	d_zoom_center(0),
+	d_preset_zoom_center(0),
 	d_mrkCtrl(nullptr),
-	d_emitNewMkrData(true)
+	d_emitNewMkrData(true),
+	d_measure_enabled(false),
+	d_measure_band_start(0),
+	d_measure_band_stop(0)
 {
 	// TO DO: Add more colors
 	d_markerColors << QColor(255, 242, 0) << QColor(210, 155, 210);
@@ -93,10 +153,14 @@ FftDisplayPlot::FftDisplayPlot(int nplots, QWidget *parent) :
 		d_freq_asc_sorted_peaks.push_back(
 			QList<std::shared_ptr<marker_data>>());
 	}
+	d_peak_finders.resize(nplots);
+	d_measures.resize(nplots);
 	d_ch_avg_obj.resize(nplots);
 
 	d_numPoints = 1024;
 	x_data = new double[d_numPoints];
+	d_level = (float *)volk_malloc(d_numPoints * sizeof(float),
+		volk_get_alignment());
 
 	dBFormatter.setTwoDecimalMode(false);
 	freqFormatter.setTwoDecimalMode(true);
@@ -149,6 +213,8 @@ FftDisplayPlot::~FftDisplayPlot()
 	if (x_data)
 		delete[] x_data;
 
+	volk_free(d_level);
+
 	for (unsigned int i = 0; i < d_nplots; i++) {
 		if (y_data[i])
 			delete[] y_data[i];
@@ -183,23 +249,35 @@ void FftDisplayPlot::setZoomerEnabled()
         }
 }
 
-void FftDisplayPlot::plotData(const std::vector<double *> pts,
-		uint64_t num_points)
+void FftDisplayPlot::plotData(const Frame *frame)
 {
-	uint64_t halfNumPoints = num_points / 2;
+	uint64_t num_points = frame->size;
 	bool numPointsChanged = false;
 	bool samplRateChanged = false;
 
 	// Update sample rate if required
-	if (d_sampl_rate != d_preset_sampl_rate) {
+	if (d_sampl_rate != d_preset_sampl_rate || d_zoom != d_preset_zoom ||
+			d_zoom_center != d_preset_zoom_center) {
 		d_sampl_rate = d_preset_sampl_rate;
-		d_start_frequency = 0;
-		d_stop_frequency = d_sampl_rate / 2;
+		d_zoom = d_preset_zoom;
+		d_zoom_center = d_preset_zoom_center;
+
+		if (d_zoom) {
+			d_start_frequency = d_zoom_center - d_sampl_rate / 2;
+			d_stop_frequency = d_zoom_center + d_sampl_rate / 2;
+		} else {
+			d_start_frequency = 0;
+			d_stop_frequency = d_sampl_rate / 2;
+		}
 		samplRateChanged = true;
 
 		Q_EMIT sampleRateUpdated(d_sampl_rate);
 	}
 
+	// A real signal only needs the lower half of its spectrum; in zoom
+	// mode all the bins are used
+	uint64_t halfNumPoints = d_zoom ? num_points : num_points / 2;
+
 	if (d_stop || halfNumPoints == 0)
 		return;
 
@@ -214,19 +292,18 @@ void FftDisplayPlot::plotData(const std::vector<double *> pts,
 
 		x_data = new double[halfNumPoints];
 
+		volk_free(d_level);
+		d_level = (float *)volk_malloc(halfNumPoints * sizeof(float),
+			volk_get_alignment());
+
 		for (unsigned int i = 0; i < d_nplots; i++) {
 			if (y_data[i])
 				delete[] y_data[i];
 
-			y_data[i] = new double[halfNumPoints];
+			y_data[i] = new float[halfNumPoints];
 
-#if QWT_VERSION < 0x060000
-			d_plot_curve[i]->setRawData(x_data,
-					y_data[i], halfNumPoints);
-#else
-			d_plot_curve[i]->setRawSamples(x_data,
-					y_data[i], halfNumPoints);
-#endif
+			d_plot_curve[i]->setData(new FftCurveData(x_data,
+					y_data[i], halfNumPoints));
 		}
 
 		// Resize the average objects to the new number of points
@@ -244,33 +321,49 @@ void FftDisplayPlot::plotData(const std::vector<double *> pts,
 		}
 	}
 
-	for (unsigned int i = 0; i < d_nplots; i++) {
-		bool needs_dB_avg = false;
+	// dB Full-Scale
+	float full_scale = 20 * log10(2048.0 * halfNumPoints);
 
-		switch (d_ch_average_type[i]) {
-		case LINEAR_DB:
-			needs_dB_avg = true;
-		case EXPONENTIAL_DB:
-			needs_dB_avg = true;
-		case SAMPLE:
-			memcpy(y_data[i], pts[i],
-				halfNumPoints * sizeof(double));
-			break;
-		default:
-			d_ch_avg_obj[i]->pushNewData(pts[i]);
-			d_ch_avg_obj[i]->getAverage(y_data[i], halfNumPoints);
-			break;
+	for (unsigned int i = 0; i < d_nplots; i++) {
+		average_sptr avg = d_ch_avg_obj[i];
+		bool in_dB = false;
+
+		if (d_zoom) {
+			// Put the negative frequencies first
+			uint64_t neg = halfNumPoints / 2;
+
+			copy_level(d_level, frame, i, halfNumPoints - neg,
+				neg);
+			copy_level(d_level + neg, frame, i, 0,
+				halfNumPoints - neg);
+		} else {
+			copy_level(d_level, frame, i, 0, halfNumPoints);
 		}
 
-		for (int s = 0; s < halfNumPoints; s++) {
-			//dB Full-Scale
-			y_data[i][s] = 10 * log10((y_data[i][s] / (2048 * 2048)) /
-				(halfNumPoints * halfNumPoints));
+		if (avg) {
+			avg->pushNewData(d_level);
+			avg->getAverage(d_level, halfNumPoints);
+			in_dB = avg->isLogarithmic();
 		}
 
-		if (needs_dB_avg) {
-			d_ch_avg_obj[i]->pushNewData(y_data[i]);
-			d_ch_avg_obj[i]->getAverage(y_data[i], halfNumPoints);
+		if (d_measure_enabled && !d_zoom)
+			measure(i, in_dB, full_scale);
+		else if (i < d_measures.size())
+			d_measures[i].invalidate();
+
+		// The levels are written straight into the curve's samples
+		float *level = y_data[i];
+
+		if (in_dB) {
+			for (uint64_t s = 0; s < halfNumPoints; s++)
+				level[s] = d_level[s] - full_scale;
+		} else {
+			volk_32f_log2_32f(level, d_level, halfNumPoints);
+			volk_32f_s32f_multiply_32f(level, level,
+				10 * log10(2.0), halfNumPoints);
+
+			for (uint64_t s = 0; s < halfNumPoints; s++)
+				level[s] -= full_scale;
 		}
 	}
 
@@ -302,6 +395,8 @@ void FftDisplayPlot::plotData(const std::vector<double *> pts,
 
 				if (marker.data->x > d_stop_frequency) {
 					marker.data->bin = d_numPoints - 1;
+				} else if (marker.data->x < d_start_frequency) {
+					marker.data->bin = 0;
 				} else {
 					marker.data->bin = posAtFrequency(
 						marker.data->x);
@@ -348,13 +443,24 @@ int64_t FftDisplayPlot:: posAtFrequency(double freq) const
 	return pos;
 }
 
+double FftDisplayPlot::frequencyAtPos(int64_t pos) const
+{
+	double fft_bin_size = (d_stop_frequency - d_start_frequency)
+		/ static_cast<double>(d_numPoints);
+
+	return d_start_frequency + pos * fft_bin_size;
+}
+
 void FftDisplayPlot::customEvent(QEvent *e)
 {
-	if (e->type() == TimeUpdateEvent::Type()) {
-		TimeUpdateEvent *ev = static_cast<TimeUpdateEvent *>(e);
+	if (e->type() == FrameUpdateEvent::Type()) {
+		FrameUpdateEvent *ev = static_cast<FrameUpdateEvent *>(e);
+		FrameRing::sptr frames = ev->frames();
 
-		this->plotData(ev->getTimeDomainPoints(),
-				ev->getNumTimeDomainDataPoints());
+		if (!frames->consume())
+			return;
+
+		this->plotData(frames->front());
 	}
 }
 
@@ -379,6 +485,12 @@ void FftDisplayPlot::presetSampleRate(double sr)
 	d_preset_sampl_rate = sr;
 }
 
+void FftDisplayPlot::presetZoom(bool en, double center_frequency)
+{
+	d_preset_zoom = en;
+	d_preset_zoom_center = en ? center_frequency : 0;
+}
+
 FftDisplayPlot::AverageType FftDisplayPlot::averageType(uint chIdx) const
 {
 	if (chIdx < d_ch_average_type.size())
@@ -438,13 +550,13 @@ FftDisplayPlot::average_sptr FftDisplayPlot::getNewAvgObject(
 			return boost::make_shared<LinearAverage>(data_width,
 				history);
 		case LINEAR_DB:
-			return boost::make_shared<LinearAverage>(data_width,
+			return boost::make_shared<LinearDB>(data_width,
 				history);
 		case EXPONENTIAL_RMS:
 			return boost::make_shared<ExponentialAverage>(
 				data_width, history);
 		case EXPONENTIAL_DB:
-			return boost::make_shared<ExponentialAverage>(
+			return boost::make_shared<ExponentialDB>(
 				data_width, history);
 		default:
 			return nullptr;
@@ -474,41 +586,23 @@ void FftDisplayPlot::findPeaks(int chn)
 {
 	QList<std::shared_ptr<struct marker_data>>& markers = d_peaks[chn];
 	QList<std::shared_ptr<struct marker_data>>& f_sort_mrks = d_freq_asc_sorted_peaks[chn];
-	int marker_count = markers.size();
-	int maxX[marker_count + 1];
-	float maxY[marker_count + 1];
-	double *x = x_data;
-	double *y = y_data[chn];
-
-	for (int i = 0; i <= marker_count; i++) {
-		maxX[i] = 0;
-		maxY[i] = -200.0;
-	}
-
-	maxY[0] = y[0];
-	for (int i = 3; i < d_numPoints; i++) {
-		for (int j = 0; j < marker_count; j++ ) {
-			if  ((y[i - 1] > maxY[j]) &&
-					((!((y[i - 2] > y[i - 1]) &&
-					 (y[i - 1] > y[i]))) &&
-					 (!((y[i - 2] < y[i - 1]) &&
-					 (y[i - 1] < y[i]))))) {
-
-				for (int k = marker_count; k > j; k--) {
-					maxY[k] = maxY[k - 1];
-					maxX[k] = maxX[k - 1];
-				}
-				maxY[j] = y[i - 1];
-				maxX[j] = i - 1;
-				break;
-			}
-		}
-	}
+	const std::vector<PeakFinder::Peak>& peaks =
+		d_peak_finders[chn].find(y_data[chn], d_numPoints);
+	double fft_bin_size = (d_stop_frequency - d_start_frequency)
+		/ static_cast<double>(d_numPoints);
 
-	for (int i = 0; i < marker_count; i++) {
-		markers[i]->x = x[maxX[i]];
-		markers[i]->y = y[maxX[i]];
-		markers[i]->bin = maxX[i];
+	for (int i = 0; i < markers.size(); i++) {
+		if ((size_t)i < peaks.size()) {
+			markers[i]->x = d_start_frequency +
+				peaks[i].position * fft_bin_size;
+			markers[i]->y = peaks[i].value;
+			markers[i]->bin = peaks[i].bin;
+		} else {
+			// Not enough peaks in the trace
+			markers[i]->x = x_data[0];
+			markers[i]->y = y_data[chn][0];
+			markers[i]->bin = 0;
+		}
 	}
 
 	for (int i = 0; i < markers.size(); i++) {
@@ -524,6 +618,88 @@ void FftDisplayPlot::findPeaks(int chn)
 	updateMarkersUi();
 }
 
+/*
+ * Measures the current frame of a channel, which is still in d_level, as
+ * linear power or in dB depending on the average
+ */
+void FftDisplayPlot::measure(int chn, bool in_dB, float full_scale)
+{
+	const float *power = d_level;
+
+	if (in_dB) {
+		d_measure_power.resize(d_numPoints);
+
+		for (int64_t i = 0; i < d_numPoints; i++)
+			d_measure_power[i] = std::pow(10.0f,
+				d_level[i] / 10.0f);
+
+		power = d_measure_power.data();
+	}
+
+	SpectralMeasure& m = d_measures[chn];
+
+	if (d_measure_band_stop > d_measure_band_start)
+		m.setBand(qBound<int64_t>(0,
+				posAtFrequency(d_measure_band_start),
+				d_numPoints - 1),
+			qBound<int64_t>(0,
+				posAtFrequency(d_measure_band_stop),
+				d_numPoints - 1));
+	else
+		m.setBand(1, 0);
+
+	m.measure(power, d_numPoints, full_scale);
+}
+
+bool FftDisplayPlot::measureEnabled() const
+{
+	return d_measure_enabled;
+}
+
+void FftDisplayPlot::setMeasureEnabled(bool en)
+{
+	d_measure_enabled = en;
+
+	if (!en)
+		for (auto& m : d_measures)
+			m.invalidate();
+}
+
+void FftDisplayPlot::setMeasureWindow(uint chIdx,
+	const std::vector<float>& window, uint lobe_bins)
+{
+	if (chIdx < d_measures.size())
+		d_measures[chIdx].setWindow(window, lobe_bins);
+}
+
+uint FftDisplayPlot::measureHarmonics() const
+{
+	return d_measures.empty() ? 0 : d_measures[0].harmonicCount();
+}
+
+void FftDisplayPlot::setMeasureHarmonics(uint count)
+{
+	for (auto& m : d_measures)
+		m.setHarmonicCount(count);
+}
+
+void FftDisplayPlot::measureBand(double& start, double& stop) const
+{
+	start = d_measure_band_start;
+	stop = d_measure_band_stop;
+}
+
+void FftDisplayPlot::setMeasureBand(double start, double stop)
+{
+	d_measure_band_start = start;
+	d_measure_band_stop = stop;
+}
+
+const SpectralMeasurements& FftDisplayPlot::measurements(uint chIdx) const
+{
+	return d_measures[chIdx].results();
+}
+
 void FftDisplayPlot::updateMarkerUi(uint chIdx, uint mkIdx)
 {
 	auto marker = d_markers[chIdx][mkIdx];
@@ -632,6 +808,7 @@ void FftDisplayPlot::setPeakCount(uint chIdx, uint count)
 
 	d_peaks[chIdx].clear();
 	d_freq_asc_sorted_peaks[chIdx].clear();
+	d_peak_finders[chIdx].setMaxPeaks(count);
 
 	for (uint i = 0; i < count; i++) {
 		auto data_marker_sp = std::make_shared<struct marker_data>();
@@ -21,9 +21,12 @@
 #define FFT_DISPLAY_PLOT_H
 
 #include "DisplayPlot.h"
+#include "peak_finder.hpp"
+#include "spectral_measure.h"
 #include <boost/shared_ptr.hpp>
 
 namespace adiscope {
+	struct Frame;
 	class SpectrumAverage;
 	class SpectrumMarker;
 	class MarkerController;
@@ -38,8 +41,8 @@ namespace adiscope {
 
 	struct marker_data {
 		int type;
-		float x;
-		float y;
+		double x;
+		double y;
 		int bin;
 		bool active;
 		bool update_ui;
@@ -66,14 +69,24 @@ namespace adiscope {
 	typedef boost::shared_ptr<SpectrumAverage> average_sptr;
 
 	private:
+		/* The frequency axis is shared by all the curves; the levels
+		 * are kept in single precision, like the rest of the FFT path */
 		double* x_data;
-		std::vector<double*> y_data;
+		std::vector<float*> y_data;
+		float *d_level;
 
 		double d_start_frequency;
 		double d_stop_frequency;
 		double d_sampl_rate;
 		double d_preset_sampl_rate;
 
+		/* Zoom mode: the frames hold a complex spectrum of a band
+		 * centered on d_zoom_center, in FFT order */
+		bool d_zoom;
+		bool d_preset_zoom;
+		double d_zoom_center;
+		double d_preset_zoom_center;
+
 		MetricPrefixFormatter dBFormatter;
 		MetricPrefixFormatter freqFormatter;
 
@@ -85,12 +98,18 @@ namespace adiscope {
 		QList<QList<marker>> d_markers;
 		QList<QList<std::shared_ptr<struct marker_data>>> d_peaks;
 		QList<QList<std::shared_ptr<struct marker_data>>> d_freq_asc_sorted_peaks;
+		std::vector<PeakFinder> d_peak_finders;
 		bool d_emitNewMkrData;
 
+		bool d_measure_enabled;
+		std::vector<SpectralMeasure> d_measures;
+		double d_measure_band_start;
+		double d_measure_band_stop;
+		std::vector<float> d_measure_power;
+
 		QList<QColor> d_markerColors;
 
-		void plotData(const std::vector<double *> pts,
-				uint64_t num_points);
+		void plotData(const Frame *frame);
 		void _resetXAxisPoints();
 
 		average_sptr getNewAvgObject(enum AverageType avg_type,
@@ -101,6 +120,7 @@ namespace adiscope {
 		void marker_set_pos_source(uint chIdx, uint mkIdx,
 			std::shared_ptr<struct marker_data> source_sptr);
 		void findPeaks(int chn);
+		void measure(int chn, bool in_dB, float full_scale);
 		void calculate_fixed_markers(int chn);
 		int getMarkerPos(const QList<marker>& marker_list,
 			 std::shared_ptr<SpectrumMarker> marker) const;
@@ -115,6 +135,7 @@ namespace adiscope {
 		~FftDisplayPlot();
 
 		int64_t posAtFrequency(double freq) const;
+		double frequencyAtPos(int64_t pos) const;
 		QString leftVerAxisUnit() const;
 		void setLeftVertAxisUnit(const QString& unit);
 		enum AverageType averageType(uint chIdx) const;
@@ -151,6 +172,17 @@ namespace adiscope {
 
 		void selectMarker(uint chIdx, uint mkIdx);
 
+		// Measurements
+		bool measureEnabled() const;
+		void setMeasureEnabled(bool en);
+		void setMeasureWindow(uint chIdx,
+			const std::vector<float>& window, uint lobe_bins);
+		uint measureHarmonics() const;
+		void setMeasureHarmonics(uint count);
+		void measureBand(double& start, double& stop) const;
+		void setMeasureBand(double start, double stop);
+		const SpectralMeasurements& measurements(uint chIdx) const;
+
 		void replot();
 		void setZoomerEnabled();
 		double sampleRate();
@@ -166,6 +198,7 @@ namespace adiscope {
 		void setSampleRate(double sr, double units,
 			const std::string &strunits);
 		void presetSampleRate(double sr);
+		void presetZoom(bool en, double center_frequency);
 		void customEvent(QEvent *e);
 	};
 }
@@ -26,6 +26,7 @@
 #include <qwt_scale_draw.h>
 #include <qwt_legend.h>
 #include <QColor>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <volk/volk.h>
@@ -35,6 +36,9 @@
 
 using namespace adiscope;
 
+/* Envelope columns computed by the sinks for each pixel of the canvas */
+static const unsigned int ENVELOPE_OVERSAMPLING = 4;
+
 class TimeDomainDisplayZoomer: public OscPlotZoomer
 {
 public:
@@ -222,26 +226,87 @@ TimeDomainDisplayPlot::~TimeDomainDisplayPlot()
 void
 TimeDomainDisplayPlot::replot()
 {
+  for (unsigned int i = 0; i < d_sinkManager.sinkListLength(); i++)
+    _updateSinkCurves(i);
+
   QwtPlot::replot();
 }
 
+void
+TimeDomainDisplayPlot::_updateSinkCurves(unsigned int sinkIndex)
+{
+  const FrameRing::sptr& frames = d_sink_frames[sinkIndex];
+  if (!frames)
+    return;
+
+  const Frame *frame = frames->front();
+  Sink *sink = d_sinkManager.sink(sinkIndex);
+  int start = d_sinkManager.sinkFirstChannelPos(sink->name());
+  const double *xdata = d_xdata[sinkIndex];
+
+  // Draw the min/max envelope instead of the raw samples when several
+  // samples fall on each pixel column and the envelope still provides at
+  // least one column per pixel for the visible interval.
+  bool useEnvelope = false;
+  int width = canvas()->width();
+
+  if (frame->env_size > 0 && !d_semilogy && width > 0) {
+    double visible = axisInterval(QwtPlot::xBottom).width() * d_sample_rate;
+    double columns = (frame->env_size / 2) *
+      std::min(visible / frame->size, 1.0);
+
+    useEnvelope = visible > 2 * width && columns >= width;
+  }
+
+  for (unsigned int i = 0; i < sink->numChannels(); i++) {
+    QwtPlotCurve *curve = d_plot_curve[start + i];
+
+    if (useEnvelope) {
+      std::vector<double>& env_x = d_env_xdata[start + i];
+      const std::vector<unsigned int>& env_idx = frame->env_idx[i];
+
+      env_x.resize(frame->env_size);
+      for (size_t n = 0; n < frame->env_size; n++)
+        env_x[n] = xdata[env_idx[n]];
+
+      curve->setRawSamples(env_x.data(), frame->env_y[i].data(),
+			   frame->env_size);
+    } else {
+      curve->setRawSamples(xdata, d_ydata[start + i], frame->size);
+    }
+  }
+}
+
 void
 TimeDomainDisplayPlot::plotNewData(const std::string sender,
-				   const std::vector<double*> dataPoints,
-				   const int64_t numDataPoints,
-				   const double timeInterval,
-				   const std::vector< std::vector<gr::tag_t> > &tags)
+				   FrameRing::sptr frames)
 {
   int sinkIndex = d_sinkManager.indexOfSink(sender);
 
-  if(!d_stop) {
-    if((numDataPoints > 0) && sinkIndex >= 0) {
+  if(!d_stop && sinkIndex >= 0) {
+    // Take ownership of the most recent frame. If the sink did not publish
+    // a new one since the last event there is nothing to redraw.
+    if(!frames->consume())
+      return;
+
+    const Frame *frame = frames->front();
+    const int64_t numDataPoints = frame->size;
+
+    if(numDataPoints > 0) {
       Sink *sink = d_sinkManager.sink((unsigned int)sinkIndex);
       int start = d_sinkManager.sinkFirstChannelPos(sender);
       unsigned int sinkNumChannels = sink->numChannels();
       unsigned long long sinkNumPoints = sink->channelsDataLength();
       bool reset_x_axis_points = d_sink_reset_x_axis_pts[sinkIndex];
 
+      // The curves of the sink point to placeholder buffers until the
+      // first frame arrives. From then on they point into the frame ring.
+      if(!d_sink_frames[sinkIndex]) {
+	for(int i = start; i < start + sinkNumChannels; i++)
+	  delete[] d_ydata[i];
+	d_sink_frames[sinkIndex] = frames;
+      }
+
       if(numDataPoints != sinkNumPoints){
 	sinkNumPoints = numDataPoints;
 	sink->setChannelsDataLength(numDataPoints);
@@ -249,13 +314,6 @@ TimeDomainDisplayPlot::plotNewData(const std::string sender,
 	delete[] d_xdata[sinkIndex];
 	d_xdata[sinkIndex] = new double[numDataPoints];
 
-	for(int i = start; i < start + sinkNumChannels; i++) {
-	  delete[] d_ydata[i];
-	  d_ydata[i] = new double[numDataPoints];
-
-	  d_plot_curve[i]->setRawSamples(d_xdata[sinkIndex], d_ydata[i], numDataPoints);
-	}
-
 	_resetXAxisPoints(d_xdata[sinkIndex], numDataPoints, d_sample_rate);
       } else if (reset_x_axis_points) {
           _resetXAxisPoints(d_xdata[sinkIndex], numDataPoints, d_sample_rate);
@@ -263,15 +321,19 @@ TimeDomainDisplayPlot::plotNewData(const std::string sender,
       }
 
       for(int i = 0; i < sinkNumChannels; i++) {
+	double *ydata = frame->data[i];
+
 	if(d_semilogy) {
 	  for(int n = 0; n < numDataPoints; n++)
-	    d_ydata[start + i][n] = fabs(dataPoints[i][n]);
-	}
-	else {
-	  memcpy(d_ydata[start + i], dataPoints[i], numDataPoints*sizeof(double));
+	    ydata[n] = fabs(ydata[n]);
 	}
+
+	d_ydata[start + i] = ydata;
       }
 
+      // Curves are pointed at the raw data or at its envelope on replot()
+      frames->setEnvelopeColumns(canvas()->width() * ENVELOPE_OVERSAMPLING);
+
       for (int i = 0; i < d_plot_curve.size(); i++)
 		d_plot_curve.at(i)->show();
       d_curves_hidden = false;
@@ -435,22 +497,15 @@ TimeDomainDisplayPlot::plotNewData(const std::string sender,
 
 void TimeDomainDisplayPlot::newData(const QEvent* updateEvent)
 {
-	IdentifiableTimeUpdateEvent *tevent = (IdentifiableTimeUpdateEvent*)updateEvent;
-	const std::vector<double*> dataPoints = tevent->getTimeDomainPoints();
-	const uint64_t numDataPoints = tevent->getNumTimeDomainDataPoints();
-	const std::vector< std::vector<gr::tag_t> > tags = tevent->getTags();
-	const std::string sender = tevent->senderName();
+	const FrameUpdateEvent *fevent =
+		static_cast<const FrameUpdateEvent *>(updateEvent);
 
-	this->plotNewData(sender,
-			dataPoints,
-			numDataPoints,
-			0,
-			tags);
+	this->plotNewData(fevent->senderName(), fevent->frames());
 }
 
 void TimeDomainDisplayPlot::customEvent(QEvent * e)
 {
-  if(e->type() == TimeUpdateEvent::Type()) {
+  if(e->type() == FrameUpdateEvent::Type()) {
     newData(e);
   }
 }
@@ -792,6 +847,7 @@ bool TimeDomainDisplayPlot::registerSink(std::string sinkUniqueNme, unsigned int
 			int n = i + numCurves;
 			d_ydata.push_back(new double[channelsDataLength]);
 			memset(d_ydata[n], 0x0, channelsDataLength * sizeof(double));
+			d_env_xdata.push_back(std::vector<double>());
 
 			QColor color = getChannelColor();
 
@@ -816,6 +872,7 @@ bool TimeDomainDisplayPlot::registerSink(std::string sinkUniqueNme, unsigned int
 		d_tag_markers.resize(d_nplots);
 
 		d_sink_reset_x_axis_pts.push_back(false);
+		d_sink_frames.push_back(FrameRing::sptr());
 	}
 
 	return ret;
@@ -837,9 +894,12 @@ bool TimeDomainDisplayPlot::unregisterSink(std::string sinkName)
 		int numChannels = d_sinkManager.sink(sinkIndex)->numChannels();
 		for (int i = offset; i < offset + numChannels; i++) {
 			cleanUpJustBeforeChannelRemoval(offset);
-			delete [] d_ydata[i];
+			if (!d_sink_frames[sinkIndex])
+				delete [] d_ydata[i];
 		}
 		d_ydata.erase(d_ydata.begin() + offset, d_ydata.begin() + offset + numChannels);
+		d_env_xdata.erase(d_env_xdata.begin() + offset,
+			d_env_xdata.begin() + offset + numChannels);
 
 		/* Remove the QwtPlotCurve */
 		for (int i = offset; i < offset + numChannels; i++) {
@@ -858,6 +918,7 @@ bool TimeDomainDisplayPlot::unregisterSink(std::string sinkName)
 
 		d_sink_reset_x_axis_pts.erase(d_sink_reset_x_axis_pts.begin() +
 			sinkIndex);
+		d_sink_frames.erase(d_sink_frames.begin() + sinkIndex);
 	}
 
 	return ret;
@@ -909,6 +970,53 @@ long TimeDomainDisplayPlot::dataStartingPoint() const
 	return d_data_starting_point;
 }
 
+int TimeDomainDisplayPlot::_sinkIndexOfCurve(unsigned int curveIdx)
+{
+	unsigned int first = 0;
+
+	for (unsigned int i = 0; i < d_sinkManager.sinkListLength(); i++) {
+		unsigned int count = d_sinkManager.sink(i)->numChannels();
+
+		if (curveIdx < first + count)
+			return i;
+		first += count;
+	}
+
+	return -1;
+}
+
+/*
+ * The curves may display a decimated envelope of the data. Users that need
+ * every sample (measurements, export) should use the raw* accessors.
+ */
+const double *TimeDomainDisplayPlot::rawData(unsigned int curveIdx)
+{
+	if (curveIdx >= d_ydata.size())
+		return nullptr;
+
+	return d_ydata[curveIdx];
+}
+
+const double *TimeDomainDisplayPlot::rawTimeData(unsigned int curveIdx)
+{
+	int sinkIndex = _sinkIndexOfCurve(curveIdx);
+
+	if (sinkIndex < 0)
+		return nullptr;
+
+	return d_xdata[sinkIndex];
+}
+
+unsigned long long TimeDomainDisplayPlot::rawDataLength(unsigned int curveIdx)
+{
+	int sinkIndex = _sinkIndexOfCurve(curveIdx);
+
+	if (sinkIndex < 0)
+		return 0;
+
+	return d_sinkManager.sink(sinkIndex)->channelsDataLength();
+}
+
 void TimeDomainDisplayPlot::resetXaxisOnNextReceivedData()
 {
 	for (int i = 0; i < d_sink_reset_x_axis_pts.size(); i++)
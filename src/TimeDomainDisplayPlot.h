@@ -84,11 +84,7 @@ public:
   TimeDomainDisplayPlot(QWidget*, unsigned int xNumDivs = 10, unsigned int yNumDivs = 10);
   virtual ~TimeDomainDisplayPlot();
 
-  void plotNewData(const std::string sender,
-		   const std::vector<double*> dataPoints,
-		   const int64_t numDataPoints, const double timeInterval,
-                   const std::vector< std::vector<gr::tag_t> > &tags \
-		   = std::vector< std::vector<gr::tag_t> >());
+  void plotNewData(const std::string sender, FrameRing::sptr frames);
 
   void replot();
 
@@ -114,6 +110,10 @@ public:
 
   long dataStartingPoint() const;
 
+  const double *rawData(unsigned int curveIdx);
+  const double *rawTimeData(unsigned int curveIdx);
+  unsigned long long rawDataLength(unsigned int curveIdx);
+
 Q_SIGNALS:
   void channelAdded(int);
   void newData();
@@ -170,12 +170,16 @@ protected:
 
 private:
   void _resetXAxisPoints(double*& xAxis, unsigned long long numPoints, double sampleRate);
+  void _updateSinkCurves(unsigned int sinkIndex);
+  int _sinkIndexOfCurve(unsigned int curveIdx);
   void _autoScale(double bottom, double top);
 
   double d_sample_rate;
   double d_delay;
   long d_data_starting_point;
   std::vector<bool> d_sink_reset_x_axis_pts;
+  std::vector<FrameRing::sptr> d_sink_frames;
+  std::vector< std::vector<double> > d_env_xdata;
 
   bool d_semilogx;
   bool d_semilogy;
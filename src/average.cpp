@@ -21,8 +21,13 @@
 #include <algorithm>
 #include <cstring>
 
+#include <volk/volk.h>
+
 using namespace adiscope;
 
+/* 10 * log10(x) = DB_PER_LOG2 * log2(x) */
+static const float DB_PER_LOG2 = 3.01029995664f;
+
 /*
  * class SpectrumAverage
  */
@@ -35,20 +40,38 @@ SpectrumAverage::SpectrumAverage(unsigned int data_width, unsigned int history):
 	if (history < 1)
 		m_history_size = 1;
 
-	m_average = new double[m_data_width];
+	unsigned int align = std::max<size_t>(1,
+		volk_get_alignment() / sizeof(float));
+	m_stride = (m_data_width + align - 1) / align * align;
+
+	m_average = alloc_rows(1);
 }
 
 SpectrumAverage::~SpectrumAverage()
 {
-	delete[] m_average;
+	free_rows(m_average);
+}
+
+float *SpectrumAverage::alloc_rows(unsigned int count) const
+{
+	size_t size = (size_t)count * m_stride * sizeof(float);
+	float *rows = (float *)volk_malloc(size, volk_get_alignment());
+
+	std::memset(rows, 0, size);
+	return rows;
+}
+
+void SpectrumAverage::free_rows(float *rows)
+{
+	volk_free(rows);
 }
 
-void SpectrumAverage::getAverage(double *out_data,
+void SpectrumAverage::getAverage(float *out_data,
 	unsigned int num_samples) const
 {
 	unsigned int size = std::min(m_data_width, num_samples);
 
-	std::memcpy(out_data, m_average, size * sizeof(double));
+	std::memcpy(out_data, m_average, size * sizeof(float));
 }
 
 unsigned int SpectrumAverage::dataWidth() const
@@ -61,6 +84,11 @@ unsigned int SpectrumAverage::history() const
 	return m_history_size;
 }
 
+bool SpectrumAverage::isLogarithmic() const
+{
+	return false;
+}
+
 /*
  * class AverageHistoryOne
  */
@@ -81,42 +109,104 @@ AverageHistoryN::AverageHistoryN(unsigned int data_width, unsigned int history):
 	SpectrumAverage(data_width, history), m_insert_index(0),
 	m_inserted_count(0)
 {
-	alloc_history(m_data_width, m_history_size);
+	m_history = alloc_rows(m_history_size);
+	m_sums = alloc_rows(1);
 }
 
 AverageHistoryN::~AverageHistoryN()
 {
-	free_history();
+	free_rows(m_history);
+	free_rows(m_sums);
 }
 
 void AverageHistoryN::reset()
 {
+	std::fill_n(m_sums, m_data_width, 0);
 	m_inserted_count = 0;
 	m_insert_index = 0;
 }
 
-void AverageHistoryN::alloc_history(unsigned int data_width,
-	unsigned int history_size)
+float *AverageHistoryN::row(unsigned int index) const
 {
-	m_history = new double*[history_size];
-	for (unsigned int i = 0; i < history_size; i++)
-		m_history[i] = new double[data_width];
-
+	return m_history + (size_t)index * m_stride;
 }
 
-void AverageHistoryN::free_history()
+void AverageHistoryN::transform(float *out, const float *data) const
 {
-	for (unsigned int i = 0; i < m_history_size; i++)
-		delete[] m_history[i];
-	delete[] m_history;
+	std::memcpy(out, data, m_data_width * sizeof(float));
 }
 
-void AverageHistoryN::pushNewData(double *data)
+void AverageHistoryN::pushNewData(const float *data)
 {
-	std::memcpy(m_history[m_insert_index], data,
-		m_data_width * sizeof(double));
+	float *dst = row(m_insert_index);
+
+	if (m_inserted_count == m_history_size)
+		volk_32f_x2_subtract_32f(m_sums, m_sums, dst, m_data_width);
+
+	transform(dst, data);
+	volk_32f_x2_add_32f(m_sums, m_sums, dst, m_data_width);
+
 	m_insert_index = (m_insert_index + 1) % m_history_size;
 	m_inserted_count = std::min(m_inserted_count + 1, m_history_size);
+
+	// Start over from the exact sum of the ring once per lap
+	if (m_insert_index == 0) {
+		std::memcpy(m_sums, row(0), m_data_width * sizeof(float));
+		for (unsigned int i = 1; i < m_history_size; i++)
+			volk_32f_x2_add_32f(m_sums, m_sums, row(i),
+				m_data_width);
+	}
+}
+
+void AverageHistoryN::getAverage(float *out_data,
+	unsigned int num_samples) const
+{
+	unsigned int num = std::min(m_data_width, num_samples);
+
+	if (m_inserted_count == 0) {
+		std::fill_n(out_data, num, 0);
+		return;
+	}
+
+	volk_32f_s32f_multiply_32f(out_data, m_sums,
+		1.0f / m_inserted_count, num);
+}
+
+/*
+ * class AverageExponential
+ */
+AverageExponential::AverageExponential(unsigned int data_width,
+	unsigned int history): AverageHistoryOne(data_width, history)
+{
+	m_scratch = alloc_rows(1);
+}
+
+AverageExponential::~AverageExponential()
+{
+	free_rows(m_scratch);
+}
+
+void AverageExponential::transform(float *out, const float *data) const
+{
+	std::memcpy(out, data, m_data_width * sizeof(float));
+}
+
+void AverageExponential::pushNewData(const float *data)
+{
+	if (!m_anyDataPushed) {
+		transform(m_average, data);
+		m_anyDataPushed = true;
+		return;
+	}
+
+	float n = m_history_size;
+
+	transform(m_scratch, data);
+	volk_32f_s32f_multiply_32f(m_scratch, m_scratch, 1.0f / n,
+		m_data_width);
+	volk_32f_s32f_multiply_32f(m_average, m_average, (n - 1.0f) / n,
+		m_data_width);
+	volk_32f_x2_add_32f(m_average, m_average, m_scratch, m_data_width);
 }
 
 /*
@@ -127,13 +217,12 @@ PeakHoldContinuous::PeakHoldContinuous(unsigned int data_width,
 {
 }
 
-void PeakHoldContinuous::pushNewData(double *data)
+void PeakHoldContinuous::pushNewData(const float *data)
 {
 	if (m_anyDataPushed) {
-		for (unsigned int i = 0; i < m_data_width; i++)
-			m_average[i] = std::max(data[i], m_average[i]);
+		volk_32f_x2_max_32f(m_average, m_average, data, m_data_width);
 	} else {
-		std::memcpy(m_average, data, m_data_width * sizeof(double));
+		std::memcpy(m_average, data, m_data_width * sizeof(float));
 		m_anyDataPushed = true;
 	}
 }
@@ -146,13 +235,12 @@ MinHoldContinuous::MinHoldContinuous(unsigned int data_width,
 {
 }
 
-void MinHoldContinuous::pushNewData(double *data)
+void MinHoldContinuous::pushNewData(const float *data)
 {
 	if (m_anyDataPushed) {
-		for (unsigned int i = 0; i < m_data_width; i++)
-			m_average[i] = std::min(data[i], m_average[i]);
+		volk_32f_x2_min_32f(m_average, m_average, data, m_data_width);
 	} else {
-		std::memcpy(m_average, data, m_data_width * sizeof(double));
+		std::memcpy(m_average, data, m_data_width * sizeof(float));
 		m_anyDataPushed = true;
 	}
 }
@@ -161,185 +249,145 @@ void MinHoldContinuous::pushNewData(double *data)
  * class ExponentialRMS
  */
 ExponentialRMS::ExponentialRMS(unsigned int data_width, unsigned int history):
-	AverageHistoryOne(data_width, history)
+	AverageExponential(data_width, history)
 {
 }
 
-void ExponentialRMS::pushNewData(double *data)
+void ExponentialRMS::transform(float *out, const float *data) const
 {
-	if (m_anyDataPushed) {
-		for (unsigned int i = 0; i < m_data_width; i++)
-			m_average[i] = (data[i] * data[i] + (m_history_size - 1)
-				* m_average[i]) / m_history_size;
-	} else {
-		for (unsigned int i = 0; i < m_data_width; i++)
-			m_average[i] = data[i] * data[i];
-		m_anyDataPushed = true;
-	}
+	volk_32f_x2_multiply_32f(out, data, data, m_data_width);
 }
 
 /*
  * class ExponentialAverage
  */
 ExponentialAverage::ExponentialAverage(unsigned int data_width, unsigned int history):
-	AverageHistoryOne(data_width, history)
+	AverageExponential(data_width, history)
 {
 }
 
-void ExponentialAverage::pushNewData(double *data)
-{
-	if (m_anyDataPushed) {
-		for (unsigned int i = 0; i < m_data_width; i++)
-			m_average[i] = (data[i] + (m_history_size - 1)
-				* m_average[i]) / m_history_size;
-	} else {
-		std::memcpy(m_average, data, m_data_width * sizeof(double));
-		m_anyDataPushed = true;
-	}
-}
-
 /*
- * class PeakHold
+ * class ExponentialDB
  */
-PeakHold::PeakHold(unsigned int data_width, unsigned int history):
-	AverageHistoryN(data_width, history)
+ExponentialDB::ExponentialDB(unsigned int data_width, unsigned int history):
+	AverageExponential(data_width, history)
 {
 }
 
-void PeakHold::pushNewData(double *data)
+void ExponentialDB::transform(float *out, const float *data) const
 {
-	double *peaks = m_average;
-
-	if (m_inserted_count == 0 || m_history_size == 1) {
-		std::memcpy(peaks, data, m_data_width * sizeof(double));
-	} else {
-		for (unsigned int i = 0; i < m_data_width; i++) {
-			if (data[i] > peaks[i])
-				peaks[i] = data[i];
-
-			if (m_inserted_count != m_history_size)
-				continue;
-
-			// If the value that we're about to drop (overwrite) is
-			// currently the peak we need to find a new peak
-			if (m_history[m_insert_index][i] == peaks[i])
-				peaks[i] = getPeakFromHistoryColumn(i);
-		}
-	}
-
-	// Let the base class handle the data storing
-	AverageHistoryN::pushNewData(data);
+	volk_32f_log2_32f(out, data, m_data_width);
 }
 
-double PeakHold::getPeakFromHistoryColumn(unsigned int col)
+void ExponentialDB::getAverage(float *out_data, unsigned int num_samples) const
 {
-	if (m_inserted_count < 2)
-		return m_history[0][col];
-
-	unsigned int start = (m_insert_index != 0) ? 0 : 1;
-	double peak = m_history[start][col];
+	unsigned int num = std::min(m_data_width, num_samples);
 
-	for (unsigned int i = start + 1; i < m_inserted_count; i++) {
-		if (i != m_insert_index && m_history[i][col] > peak)
-			peak = m_history[i][col];
-	}
+	volk_32f_s32f_multiply_32f(out_data, m_average, DB_PER_LOG2, num);
+}
 
-	return peak;
+bool ExponentialDB::isLogarithmic() const
+{
+	return true;
 }
 
 /*
- * class MinHold
+ * class SlidingExtremum
  */
-MinHold::MinHold(unsigned int data_width, unsigned int history):
-	AverageHistoryN(data_width, history)
+SlidingExtremum::SlidingExtremum(unsigned int data_width, unsigned int history):
+	SpectrumAverage(data_width, history), m_position(0),
+	m_has_previous(false)
 {
+	m_current = alloc_rows(m_history_size);
+	m_previous = alloc_rows(m_history_size);
+	m_prefix = alloc_rows(1);
 }
 
-void MinHold::pushNewData(double *data)
+SlidingExtremum::~SlidingExtremum()
 {
-	double *mins = m_average;
-
-	if (m_inserted_count == 0 || m_history_size == 1) {
-		std::memcpy(mins, data, m_data_width * sizeof(double));
-	} else {
-		for (unsigned int i = 0; i < m_data_width; i++) {
-			if (data[i] < mins[i])
-				mins[i] = data[i];
-
-			if (m_inserted_count != m_history_size)
-				continue;
-
-			// If the value that we're about to drop (overwrite) is
-			// currently the min we need to find a new min
-			if (m_history[m_insert_index][i] == mins[i])
-				mins[i] = getMinFromHistoryColumn(i);
-		}
-	}
+	free_rows(m_current);
+	free_rows(m_previous);
+	free_rows(m_prefix);
+}
 
-	// Let the base class handle the data storing
-	AverageHistoryN::pushNewData(data);
+void SlidingExtremum::reset()
+{
+	m_position = 0;
+	m_has_previous = false;
 }
 
-double MinHold::getMinFromHistoryColumn(unsigned int col)
+void SlidingExtremum::pushNewData(const float *data)
 {
-	if (m_inserted_count < 2)
-		return m_history[0][col];
+	float *row = m_current + (size_t)m_position * m_stride;
+
+	std::memcpy(row, data, m_data_width * sizeof(float));
+
+	if (m_position == 0)
+		std::memcpy(m_prefix, data, m_data_width * sizeof(float));
+	else
+		combine(m_prefix, m_prefix, data);
+
+	// The window holds rows [m_position + 1, N) of the previous block and
+	// rows [0, m_position] of the current one
+	if (m_has_previous && m_position + 1 < m_history_size)
+		combine(m_average, m_previous +
+			(size_t)(m_position + 1) * m_stride, m_prefix);
+	else
+		std::memcpy(m_average, m_prefix,
+			m_data_width * sizeof(float));
 
-	unsigned int start = (m_insert_index != 0) ? 0 : 1;
-	double min = m_history[start][col];
+	if (++m_position < m_history_size)
+		return;
 
-	for (unsigned int i = start + 1; i < m_inserted_count; i++) {
-		if (i != m_insert_index && m_history[i][col] < min)
-			min = m_history[i][col];
+	// The block is complete: turn it into suffix extrema, backwards
+	for (unsigned int i = m_history_size - 1; i > 0; i--) {
+		float *dst = m_current + (size_t)(i - 1) * m_stride;
+
+		combine(dst, dst, dst + m_stride);
 	}
 
-	return min;
+	std::swap(m_current, m_previous);
+	m_position = 0;
+	m_has_previous = true;
 }
 
 /*
- * class LinearRMS
+ * class PeakHold
  */
-LinearRMS::LinearRMS(unsigned int data_width, unsigned int history):
-	AverageHistoryN(data_width, history)
+PeakHold::PeakHold(unsigned int data_width, unsigned int history):
+	SlidingExtremum(data_width, history)
 {
-	m_sqr_sums = new double[data_width]();
 }
 
-LinearRMS::~LinearRMS()
+void PeakHold::combine(float *out, const float *a, const float *b) const
 {
-	delete[] m_sqr_sums;
+	volk_32f_x2_max_32f(out, a, b, m_data_width);
 }
 
-void LinearRMS::pushNewData(double *data)
+/*
+ * class MinHold
+ */
+MinHold::MinHold(unsigned int data_width, unsigned int history):
+	SlidingExtremum(data_width, history)
 {
-	if (m_inserted_count != m_history_size) {
-		for (unsigned int i = 0; i < m_data_width; i++) {
-			m_sqr_sums[i] += (data[i] * data[i]);
-		}
-	} else {
-		for (unsigned int i = 0; i < m_data_width; i++) {
-			m_sqr_sums[i] -= (m_history[m_insert_index][i] *
-				m_history[m_insert_index][i]);
-			m_sqr_sums[i] += (data[i] * data[i]);
-		}
-	}
-
-	// Let the base class handle the data storing
-	AverageHistoryN::pushNewData(data);
 }
 
-void LinearRMS::getAverage(double *out_data, unsigned int num_samples) const
+void MinHold::combine(float *out, const float *a, const float *b) const
 {
-	unsigned int num = std::min(m_data_width, num_samples);
+	volk_32f_x2_min_32f(out, a, b, m_data_width);
+}
 
-	for (unsigned int i = 0; i < num; i++)
-		out_data[i] = m_sqr_sums[i] / m_inserted_count;
+/*
+ * class LinearRMS
+ */
+LinearRMS::LinearRMS(unsigned int data_width, unsigned int history):
+	AverageHistoryN(data_width, history)
+{
 }
 
-void LinearRMS::reset()
+void LinearRMS::transform(float *out, const float *data) const
 {
-	std::fill_n(m_sqr_sums, m_data_width, 0);
-	AverageHistoryN::reset();
+	volk_32f_x2_multiply_32f(out, data, data, m_data_width);
 }
 
 /*
@@ -348,41 +396,35 @@ void LinearRMS::reset()
 LinearAverage::LinearAverage(unsigned int data_width, unsigned int history):
 	AverageHistoryN(data_width, history)
 {
-	m_sums = new double[data_width]();
 }
 
-LinearAverage::~LinearAverage()
+/*
+ * class LinearDB
+ */
+LinearDB::LinearDB(unsigned int data_width, unsigned int history):
+	AverageHistoryN(data_width, history)
 {
-	delete[] m_sums;
 }
 
-void LinearAverage::pushNewData(double *data)
+void LinearDB::transform(float *out, const float *data) const
 {
-	if (m_inserted_count != m_history_size) {
-		for (unsigned int i = 0; i < m_data_width; i++) {
-			m_sums[i] += data[i];
-		}
-	} else {
-		for (unsigned int i = 0; i < m_data_width; i++) {
-			m_sums[i] -= m_history[m_insert_index][i];
-			m_sums[i] += data[i];
-		}
-	}
-
-	// Let the base class handle the data storing
-	AverageHistoryN::pushNewData(data);
+	volk_32f_log2_32f(out, data, m_data_width);
 }
 
-void LinearAverage::getAverage(double *out_data, unsigned int num_samples) const
+void LinearDB::getAverage(float *out_data, unsigned int num_samples) const
 {
 	unsigned int num = std::min(m_data_width, num_samples);
 
-	for (unsigned int i = 0; i < num; i++)
-		out_data[i] = m_sums[i] / m_inserted_count;
+	if (m_inserted_count == 0) {
+		std::fill_n(out_data, num, 0);
+		return;
+	}
+
+	volk_32f_s32f_multiply_32f(out_data, m_sums,
+		DB_PER_LOG2 / m_inserted_count, num);
 }
 
-void LinearAverage::reset()
+bool LinearDB::isLogarithmic() const
 {
-	std::fill_n(m_sums, m_data_width, 0);
-	AverageHistoryN::reset();
+	return true;
 }
@@ -22,22 +22,35 @@
 
 namespace adiscope {
 
-
+/*
+ * The averages work on float rows. Every row handed to or kept by an average
+ * is a multiple of the VOLK alignment apart from the previous one in a single
+ * allocation, so each operation on a row is one VOLK kernel call.
+ */
 class SpectrumAverage {
 public:
 	SpectrumAverage(unsigned int data_width, unsigned int history);
 	virtual ~SpectrumAverage();
-	virtual void pushNewData(double *data) = 0;
-	virtual void getAverage(double *out_data,
+	virtual void pushNewData(const float *data) = 0;
+	virtual void getAverage(float *out_data,
 		unsigned int num_samples) const;
 	virtual void reset() = 0;
 	unsigned int dataWidth() const;
 	unsigned int history() const;
 
+	/* True if the average is returned in dB instead of linear power */
+	virtual bool isLogarithmic() const;
+
 protected:
+	/* Aligned storage for the given number of rows, to release with
+	 * free_rows() */
+	float *alloc_rows(unsigned int count) const;
+	static void free_rows(float *rows);
+
 	unsigned int m_data_width;
 	unsigned int m_history_size;
-	double *m_average;
+	unsigned int m_stride;
+	float *m_average;
 };
 
 class AverageHistoryOne: public SpectrumAverage
@@ -50,98 +63,175 @@ protected:
 	bool m_anyDataPushed;
 };
 
+/*
+ * Keeps the last N rows in a ring, together with their running sum. The sum
+ * is rebuilt from the ring every time it wraps around, so the float rounding
+ * errors of the incremental updates never accumulate past N pushes.
+ */
 class AverageHistoryN: public SpectrumAverage
 {
 public:
 	AverageHistoryN(unsigned int data_width, unsigned int history);
 	virtual ~AverageHistoryN();
-	virtual void pushNewData(double *data);
+	virtual void pushNewData(const float *data);
+	virtual void getAverage(float *out_data,
+		unsigned int num_samples) const;
 	virtual void reset();
 
 protected:
-	double **m_history;
+	/* Stores the row as it must be summed; the default copies it */
+	virtual void transform(float *out, const float *data) const;
+
+	float *row(unsigned int index) const;
+
+	float *m_history;
+	float *m_sums;
 	unsigned int m_insert_index;
 	unsigned int m_inserted_count;
+};
+
+/*
+ * Exponential moving average: avg = avg * (N - 1) / N + data / N.
+ */
+class AverageExponential: public AverageHistoryOne
+{
+public:
+	AverageExponential(unsigned int data_width, unsigned int history);
+	virtual ~AverageExponential();
+	virtual void pushNewData(const float *data);
+
+protected:
+	/* Same as AverageHistoryN::transform() */
+	virtual void transform(float *out, const float *data) const;
 
 private:
-	void alloc_history(unsigned int data_width, unsigned int history_size);
-	void free_history();
+	float *m_scratch;
 };
 
 class PeakHoldContinuous: public AverageHistoryOne
 {
 public:
 	PeakHoldContinuous(unsigned int data_width, unsigned int history);
-	virtual void pushNewData(double *data);
+	virtual void pushNewData(const float *data);
 };
 
 class MinHoldContinuous: public AverageHistoryOne
 {
 public:
 	MinHoldContinuous(unsigned int data_width, unsigned int history);
-	virtual void pushNewData(double *data);
+	virtual void pushNewData(const float *data);
 };
 
-class ExponentialRMS: public AverageHistoryOne
+class ExponentialRMS: public AverageExponential
 {
 public:
 	ExponentialRMS(unsigned int data_width, unsigned int history);
-	virtual void pushNewData(double *data);
+
+protected:
+	virtual void transform(float *out, const float *data) const;
 };
 
-class ExponentialAverage: public AverageHistoryOne
+class ExponentialAverage: public AverageExponential
 {
 public:
 	ExponentialAverage(unsigned int data_width, unsigned int history);
-	virtual void pushNewData(double *data);
 };
 
-class PeakHold: public AverageHistoryN
+/*
+ * Exponential average of the power in dB. The rows are averaged as log2 of
+ * the power, which VOLK computes for a whole row at once, and only the
+ * result is scaled to dB.
+ */
+class ExponentialDB: public AverageExponential
 {
 public:
-	PeakHold(unsigned int data_width, unsigned int history);
-	virtual void pushNewData(double *data);
+	ExponentialDB(unsigned int data_width, unsigned int history);
+	virtual void getAverage(float *out_data,
+		unsigned int num_samples) const;
+	virtual bool isLogarithmic() const;
+
+protected:
+	virtual void transform(float *out, const float *data) const;
+};
+
+/*
+ * Sliding window extremum of each bin over the last N pushed rows, computed
+ * with the van Herk/Gil-Werman method. The rows are split in blocks of N.
+ * When a block is complete its rows are replaced, in place, with the suffix
+ * extrema of the block. The window then spans the tail of the previous
+ * block, whose extremum is one of those stored suffixes, and the head of the
+ * current block, whose extremum is kept as a running prefix. This costs at
+ * most three row operations per push regardless of N.
+ */
+class SlidingExtremum: public SpectrumAverage
+{
+public:
+	SlidingExtremum(unsigned int data_width, unsigned int history);
+	virtual ~SlidingExtremum();
+	virtual void pushNewData(const float *data);
+	virtual void reset();
+
+protected:
+	/* out[i] = extremum(a[i], b[i]) for the whole row */
+	virtual void combine(float *out, const float *a,
+		const float *b) const = 0;
 
 private:
-	double getPeakFromHistoryColumn(unsigned int col);
+	float *m_current;
+	float *m_previous;
+	float *m_prefix;
+	unsigned int m_position;
+	bool m_has_previous;
+};
+
+class PeakHold: public SlidingExtremum
+{
+public:
+	PeakHold(unsigned int data_width, unsigned int history);
+
+protected:
+	virtual void combine(float *out, const float *a,
+		const float *b) const;
 };
 
-class MinHold: public AverageHistoryN
+class MinHold: public SlidingExtremum
 {
 public:
 	MinHold(unsigned int data_width, unsigned int history);
-	virtual void pushNewData(double *data);
 
-private:
-	double getMinFromHistoryColumn(unsigned int col);
+protected:
+	virtual void combine(float *out, const float *a,
+		const float *b) const;
 };
 
 class LinearRMS: public AverageHistoryN
 {
 public:
 	LinearRMS(unsigned int data_width, unsigned int history);
-	~LinearRMS();
-	virtual void pushNewData(double *data);
-	virtual void getAverage(double *out_data,
-		unsigned int num_samples) const;
-	virtual void reset();
 
-private:
-	double *m_sqr_sums;
+protected:
+	virtual void transform(float *out, const float *data) const;
 };
 
 class LinearAverage: public AverageHistoryN
 {
 public:
 	LinearAverage(unsigned int data_width, unsigned int history);
-	~LinearAverage();
-	virtual void pushNewData(double *data);
-	virtual void getAverage(double *out_data,
+};
+
+/*
+ * Linear average of the power in dB, kept as log2 like ExponentialDB.
+ */
+class LinearDB: public AverageHistoryN
+{
+public:
+	LinearDB(unsigned int data_width, unsigned int history);
+	virtual void getAverage(float *out_data,
 		unsigned int num_samples) const;
-	virtual void reset();
+	virtual bool isLogarithmic() const;
 
-private:
-	double *m_sums;
+protected:
+	virtual void transform(float *out, const float *data) const;
 };
 
 } // namespace adiscope
@@ -17,56 +17,200 @@
  * Boston, MA 02110-1301, USA.
  */
 
-#include <gnuradio/blocks/stream_to_vector.h>
-#include <gnuradio/blocks/vector_to_stream.h>
-#include <gnuradio/fft/fft_vcc.h>
-#include <gnuradio/fft/fft_vfc.h>
-#include <gnuradio/fft/window.h>
-
 #include "fft_block.hpp"
 
+#include <algorithm>
+#include <string.h>
+
+#include <gnuradio/fft/window.h>
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
 using namespace adiscope;
 using namespace gr;
 
-fft_block::fft_block(bool use_complex, size_t fft_size, unsigned int nbthreads)
-	: hier_block2("FFT",
-			io_signature::make(1, 1, use_complex ?
-				sizeof(gr_complex) : sizeof(float)),
-			io_signature::make(1, 1, sizeof(gr_complex))),
-	d_complex(use_complex)
-{
-	auto s2v = blocks::stream_to_vector::make(
-			use_complex ? sizeof(gr_complex) : sizeof(float),
-			fft_size);
-	auto v2s = blocks::vector_to_stream::make(sizeof(gr_complex), fft_size);
+const size_t fft_block::MIN_SIZE_THREADED_PLAN;
 
+fft_block::fft_block(bool use_complex, size_t fft_size,
+		unsigned int nb_channels, unsigned int nbthreads)
+	: sync_block("FFT",
+			io_signature::make(nb_channels, nb_channels,
+				use_complex ? sizeof(gr_complex) :
+				sizeof(float)),
+			io_signature::make(nb_channels, nb_channels,
+				sizeof(float))),
+	d_complex(use_complex),
+	d_fft_size(fft_size),
+	d_nb_channels(nb_channels),
+	d_in(nullptr),
+	d_out(nullptr),
+	d_nb_jobs(0),
+	d_next_job(0),
+	d_generation(0),
+	d_busy(0),
+	d_stop(false)
+{
 	/* We use a Hamming window for now */
-	auto window = fft::window::hamming(fft_size);
-
-	//basic_block_sptr fft;
-	if (use_complex)
-		d_fft = fft::fft_vcc::make(fft_size, true,
-				window, false, nbthreads);
-	else
-		d_fft = fft::fft_vfc::make(fft_size, true,
-				window, nbthreads);
-
-	/* Connect everything */
-	hier_block2::connect(this->self(), 0, s2v, 0);
-	hier_block2::connect(s2v, 0, d_fft, 0);
-	hier_block2::connect(d_fft, 0, v2s, 0);
-	hier_block2::connect(v2s, 0, this->self(), 0);
+	d_windows.assign(nb_channels, fft_plan_cache::get_window(
+				fft::window::WIN_HAMMING, fft_size));
+
+	unsigned int nb_workers = std::max(1u,
+			std::min(nbthreads, nb_channels));
+	unsigned int plan_threads = 1;
+
+	if (fft_size >= MIN_SIZE_THREADED_PLAN)
+		plan_threads = std::max(1u, nbthreads / nb_workers);
+
+	for (unsigned int i = 0; i < nb_workers; i++) {
+		Worker *worker = new Worker;
+
+		if (use_complex)
+			worker->fft_complex = fft_plan_cache::get_complex(
+					fft_size, plan_threads);
+		else
+			worker->fft_real = fft_plan_cache::get_real(fft_size,
+					plan_threads);
+
+		d_workers.push_back(worker);
+	}
+
+	/* The first worker runs in the scheduler's thread */
+	for (unsigned int i = 1; i < nb_workers; i++)
+		d_workers[i]->thread = std::thread(&fft_block::worker_thread,
+				this, d_workers[i]);
+
+	set_output_multiple(fft_size);
+	set_tag_propagation_policy(TPP_ONE_TO_ONE);
+
+	const int alignment_multiple = volk_get_alignment() / sizeof(float);
+	set_alignment(std::max(1, alignment_multiple));
 }
 
 fft_block::~fft_block()
 {
+	{
+		std::unique_lock<std::mutex> lock(d_mutex);
+		d_stop = true;
+	}
+	d_start_cond.notify_all();
+
+	for (auto worker : d_workers) {
+		if (worker->thread.joinable())
+			worker->thread.join();
+
+		delete worker;
+	}
+}
+
+bool fft_block::set_window(fft_plan_cache::window_sptr window, int chn)
+{
+	if (!window || window->size() != d_fft_size ||
+			chn >= (int)d_nb_channels)
+		return false;
+
+	gr::thread::scoped_lock lock(d_setlock);
+
+	for (unsigned int i = 0; i < d_nb_channels; i++)
+		if (chn < 0 || (unsigned int)chn == i)
+			d_windows[i] = window;
+
+	return true;
 }
 
-bool fft_block::set_window(const std::vector<float>& window)
+void fft_block::transform(Worker *worker, unsigned int job)
 {
+	unsigned int chn = job % d_nb_channels;
+	size_t offset = (job / d_nb_channels) * d_fft_size;
+	const float *window = d_windows[chn]->data();
+	float *out = (float *)(*d_out)[chn] + offset;
+
 	if (d_complex) {
-		boost::dynamic_pointer_cast<fft::fft_vcc>(d_fft)->set_window(window);
+		const gr_complex *in = (const gr_complex *)(*d_in)[chn] +
+			offset;
+
+		volk_32fc_32f_multiply_32fc(worker->fft_complex->get_inbuf(),
+				in, window, d_fft_size);
+		worker->fft_complex->execute();
+		volk_32fc_magnitude_squared_32f(out,
+				worker->fft_complex->get_outbuf(),
+				d_fft_size);
 	} else {
-		boost::dynamic_pointer_cast<fft::fft_vfc>(d_fft)->set_window(window);
+		const float *in = (const float *)(*d_in)[chn] + offset;
+		size_t nb_bins = d_fft_size / 2 + 1;
+
+		volk_32f_x2_multiply_32f(worker->fft_real->get_inbuf(),
+				in, window, d_fft_size);
+		worker->fft_real->execute();
+		volk_32fc_magnitude_squared_32f(out,
+				worker->fft_real->get_outbuf(), nb_bins);
+
+		for (size_t i = nb_bins; i < d_fft_size; i++)
+			out[i] = out[d_fft_size - i];
+	}
+}
+
+void fft_block::run_jobs(Worker *worker)
+{
+	for (;;) {
+		unsigned int job = d_next_job++;
+
+		if (job >= d_nb_jobs)
+			break;
+
+		transform(worker, job);
 	}
 }
+
+void fft_block::worker_thread(Worker *worker)
+{
+	unsigned int generation = 0;
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	for (;;) {
+		d_start_cond.wait(lock, [&]{
+			return d_stop || d_generation != generation;
+		});
+
+		if (d_stop)
+			break;
+
+		generation = d_generation;
+
+		lock.unlock();
+		run_jobs(worker);
+		lock.lock();
+
+		if (--d_busy == 0)
+			d_done_cond.notify_one();
+	}
+}
+
+int fft_block::work(int noutput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	gr::thread::scoped_lock lock(d_setlock);
+
+	d_in = &input_items;
+	d_out = &output_items;
+	d_nb_jobs = (noutput_items / d_fft_size) * d_nb_channels;
+	d_next_job = 0;
+
+	if (d_workers.size() == 1 || d_nb_jobs == 1) {
+		run_jobs(d_workers[0]);
+		return noutput_items;
+	}
+
+	std::unique_lock<std::mutex> pool_lock(d_mutex);
+	d_busy = d_workers.size() - 1;
+	d_generation++;
+	pool_lock.unlock();
+	d_start_cond.notify_all();
+
+	run_jobs(d_workers[0]);
+
+	pool_lock.lock();
+	d_done_cond.wait(pool_lock, [this]{ return d_busy == 0; });
+
+	return noutput_items;
+}
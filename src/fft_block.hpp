@@ -20,21 +20,76 @@
 #ifndef FFT_BLOCK_HPP
 #define FFT_BLOCK_HPP
 
-#include <gnuradio/hier_block2.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gnuradio/sync_block.h>
+
+#include "fft_plan_cache.hpp"
 
 namespace adiscope {
-	class fft_block : public gr::hier_block2
+	/*
+	 * Windowed FFT of one or more channels. Each input stream is cut in
+	 * frames of fft_size samples, and the matching output frame holds the
+	 * squared magnitude of the bins. For a real input, the bins above
+	 * fft_size / 2 mirror the ones below.
+	 *
+	 * The frames of all the channels are spread over a pool of worker
+	 * threads, each one owning its FFT plan. Large FFTs can additionally
+	 * be split between threads by FFTW itself, so that the whole thread
+	 * budget is used even with a single channel.
+	 */
+	class fft_block : public gr::sync_block
 	{
 	public:
 		fft_block(bool use_complex, size_t fft_size,
+				unsigned int nb_channels = 1,
 				unsigned int nbthreads = 1);
 		~fft_block();
 
-		bool set_window(const std::vector<float>& window);
+		/* Sets the window of one channel, or of all of them if chn
+		 * is negative */
+		bool set_window(fft_plan_cache::window_sptr window,
+				int chn = -1);
+
+		int work(int noutput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
 
 	private:
+		/* Below this size, FFTW threads cost more than they save */
+		static const size_t MIN_SIZE_THREADED_PLAN = 1 << 15;
+
+		struct Worker {
+			fft_plan_cache::complex_sptr fft_complex;
+			fft_plan_cache::real_sptr fft_real;
+			std::thread thread;
+		};
+
+		void transform(Worker *worker, unsigned int job);
+		void run_jobs(Worker *worker);
+		void worker_thread(Worker *worker);
+
 		bool d_complex;
-		gr::basic_block_sptr d_fft;
+		size_t d_fft_size;
+		unsigned int d_nb_channels;
+		std::vector<fft_plan_cache::window_sptr> d_windows;
+		std::vector<Worker *> d_workers;
+
+		/* Jobs of the current work() call, one per channel and frame */
+		const gr_vector_const_void_star *d_in;
+		gr_vector_void_star *d_out;
+		unsigned int d_nb_jobs;
+		std::atomic<unsigned int> d_next_job;
+
+		std::mutex d_mutex;
+		std::condition_variable d_start_cond, d_done_cond;
+		unsigned int d_generation;
+		unsigned int d_busy;
+		bool d_stop;
 	};
 }
 
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "fft_plan_cache.hpp"
+
+#include <list>
+#include <mutex>
+#include <set>
+#include <tuple>
+
+#include <fftw3.h>
+
+using namespace adiscope;
+using namespace gr;
+
+const size_t fft_plan_cache::MAX_IDLE_PLAN_BYTES;
+const size_t fft_plan_cache::MAX_WINDOW_BYTES;
+
+namespace {
+	struct PlanKey {
+		size_t size;
+		bool complex;
+		unsigned int nthreads;
+
+		bool operator<(const PlanKey& other) const
+		{
+			return std::tie(size, complex, nthreads) <
+				std::tie(other.size, other.complex,
+						other.nthreads);
+		}
+
+		bool operator==(const PlanKey& other) const
+		{
+			return size == other.size &&
+				complex == other.complex &&
+				nthreads == other.nthreads;
+		}
+
+		/* Memory held by the input and output buffers of the plan */
+		size_t bytes() const
+		{
+			if (complex)
+				return 2 * size * sizeof(gr_complex);
+			else
+				return size * sizeof(float) +
+					(size / 2 + 1) * sizeof(gr_complex);
+		}
+	};
+
+	struct IdlePlan {
+		PlanKey key;
+		fft::fft_complex *fft_complex;
+		fft::fft_real_fwd *fft_real;
+	};
+
+	struct WindowKey {
+		fft::window::win_type type;
+		size_t size;
+		double beta;
+
+		bool operator==(const WindowKey& other) const
+		{
+			return type == other.type && size == other.size &&
+				beta == other.beta;
+		}
+	};
+
+	struct CachedWindow {
+		WindowKey key;
+		fft_plan_cache::window_sptr window;
+	};
+
+	/*
+	 * Never destroyed: plans may still be handed back by blocks that
+	 * are torn down during the static destruction.
+	 */
+	struct CacheState {
+		std::mutex mutex;
+
+		/* Most recently used last */
+		std::list<IdlePlan> idle;
+		size_t idle_bytes;
+		std::list<CachedWindow> windows;
+		size_t window_bytes;
+
+		std::set<PlanKey> planned;
+		std::string wisdom_file;
+
+		CacheState() : idle_bytes(0), window_bytes(0) {}
+	};
+
+	CacheState& state()
+	{
+		static CacheState *cache = new CacheState;
+		return *cache;
+	}
+
+	void delete_plan(const IdlePlan& plan)
+	{
+		delete plan.fft_complex;
+		delete plan.fft_real;
+	}
+
+	/* Must be called with the cache locked */
+	void save_wisdom(CacheState& cache)
+	{
+		if (cache.wisdom_file.empty())
+			return;
+
+		fft::planner::scoped_lock lock(fft::planner::mutex());
+		fftwf_export_wisdom_to_filename(cache.wisdom_file.c_str());
+	}
+
+	/* Takes an idle plan out of the cache, if there's one */
+	bool take_idle(const PlanKey& key, IdlePlan& plan)
+	{
+		CacheState& cache = state();
+		std::unique_lock<std::mutex> lock(cache.mutex);
+
+		for (auto it = cache.idle.rbegin(); it != cache.idle.rend();
+				++it) {
+			if (it->key == key) {
+				plan = *it;
+				cache.idle_bytes -= key.bytes();
+				cache.idle.erase(std::next(it).base());
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void release(const IdlePlan& plan)
+	{
+		CacheState& cache = state();
+		std::list<IdlePlan> evicted;
+		std::unique_lock<std::mutex> lock(cache.mutex);
+
+		cache.idle.push_back(plan);
+		cache.idle_bytes += plan.key.bytes();
+
+		while (cache.idle_bytes >
+				fft_plan_cache::MAX_IDLE_PLAN_BYTES) {
+			cache.idle_bytes -= cache.idle.front().key.bytes();
+			evicted.splice(evicted.end(), cache.idle,
+					cache.idle.begin());
+		}
+
+		lock.unlock();
+
+		for (auto& it : evicted)
+			delete_plan(it);
+	}
+
+	/* Saves the wisdom the first time a plan of this kind is made */
+	void planned(const PlanKey& key)
+	{
+		CacheState& cache = state();
+		std::unique_lock<std::mutex> lock(cache.mutex);
+
+		if (cache.planned.insert(key).second)
+			save_wisdom(cache);
+	}
+}
+
+fft_plan_cache::complex_sptr fft_plan_cache::get_complex(size_t size,
+		unsigned int nthreads)
+{
+	PlanKey key = { size, true, nthreads };
+	IdlePlan plan;
+
+	if (!take_idle(key, plan)) {
+		plan.key = key;
+		plan.fft_real = nullptr;
+		plan.fft_complex = new fft::fft_complex(size, true, nthreads);
+		planned(key);
+	}
+
+	return complex_sptr(plan.fft_complex, [plan](fft::fft_complex *) {
+		release(plan);
+	});
+}
+
+fft_plan_cache::real_sptr fft_plan_cache::get_real(size_t size,
+		unsigned int nthreads)
+{
+	PlanKey key = { size, false, nthreads };
+	IdlePlan plan;
+
+	if (!take_idle(key, plan)) {
+		plan.key = key;
+		plan.fft_complex = nullptr;
+		plan.fft_real = new fft::fft_real_fwd(size, nthreads);
+		planned(key);
+	}
+
+	return real_sptr(plan.fft_real, [plan](fft::fft_real_fwd *) {
+		release(plan);
+	});
+}
+
+fft_plan_cache::window_sptr fft_plan_cache::get_window(
+		fft::window::win_type type, size_t size, double beta)
+{
+	CacheState& cache = state();
+	WindowKey key = { type, size, beta };
+	std::unique_lock<std::mutex> lock(cache.mutex);
+
+	for (auto it = cache.windows.begin(); it != cache.windows.end();
+			++it) {
+		if (it->key == key) {
+			cache.windows.splice(cache.windows.end(),
+					cache.windows, it);
+			return it->window;
+		}
+	}
+
+	lock.unlock();
+
+	window_sptr window = std::make_shared<const std::vector<float> >(
+			fft::window::build(type, size, beta));
+
+	lock.lock();
+
+	CachedWindow entry = { key, window };
+	cache.windows.push_back(entry);
+	cache.window_bytes += size * sizeof(float);
+
+	/* The windows still in use by a block live on until it drops them */
+	while (cache.windows.size() > 1 &&
+			cache.window_bytes > MAX_WINDOW_BYTES) {
+		cache.window_bytes -= cache.windows.front().key.size *
+			sizeof(float);
+		cache.windows.pop_front();
+	}
+
+	return window;
+}
+
+void fft_plan_cache::set_wisdom_file(const std::string& path)
+{
+	CacheState& cache = state();
+	std::unique_lock<std::mutex> lock(cache.mutex);
+
+	cache.wisdom_file = path;
+
+	fft::planner::scoped_lock planner_lock(fft::planner::mutex());
+	fftwf_import_wisdom_from_filename(path.c_str());
+}
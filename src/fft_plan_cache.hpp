@@ -0,0 +1,69 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FFT_PLAN_CACHE_HPP
+#define FFT_PLAN_CACHE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gnuradio/fft/fft.h>
+#include <gnuradio/fft/window.h>
+
+namespace adiscope {
+	/*
+	 * Process-wide cache of FFT plans and window tables.
+	 *
+	 * A plan handed out by the cache goes back to it once the last
+	 * reference is dropped, so that the next block of the same size can
+	 * reuse it instead of planning and allocating again. Only a bounded
+	 * amount of memory is kept in idle plans and windows; the least
+	 * recently used ones are freed first.
+	 *
+	 * The FFTW wisdom is loaded from and saved to a file, so that the
+	 * sizes measured once don't have to be measured again in the next
+	 * sessions.
+	 */
+	class fft_plan_cache
+	{
+	public:
+		typedef std::shared_ptr<gr::fft::fft_complex> complex_sptr;
+		typedef std::shared_ptr<gr::fft::fft_real_fwd> real_sptr;
+		typedef std::shared_ptr<const std::vector<float> > window_sptr;
+
+		/* Forward FFT plans */
+		static complex_sptr get_complex(size_t size,
+				unsigned int nthreads = 1);
+		static real_sptr get_real(size_t size,
+				unsigned int nthreads = 1);
+
+		static window_sptr get_window(gr::fft::window::win_type type,
+				size_t size, double beta = 0.0);
+
+		/* Loads the wisdom from this file, where the wisdom of any
+		 * new plan will be saved */
+		static void set_wisdom_file(const std::string& path);
+
+		static const size_t MAX_IDLE_PLAN_BYTES = 64 << 20;
+		static const size_t MAX_WINDOW_BYTES = 32 << 20;
+	};
+}
+
+#endif /* FFT_PLAN_CACHE_HPP */
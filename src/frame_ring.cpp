@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "frame_ring.hpp"
+
+#include <algorithm>
+#include <string.h>
+#include <volk/volk.h>
+
+using namespace adiscope;
+
+FrameRing::FrameRing(unsigned int nchannels) :
+	d_nchannels(nchannels),
+	d_back(0),
+	d_front(1),
+	d_middle(2),
+	d_env_columns(0),
+	d_env_scratch(nullptr),
+	d_env_scratch_size(0)
+{
+	for (int i = 0; i < 3; i++) {
+		d_frames[i].data = std::vector<double *>(nchannels, nullptr);
+		d_frames[i].tags = std::vector< std::vector<gr::tag_t> >(
+			nchannels);
+		d_frames[i].size = 0;
+		d_frames[i].capacity = 0;
+		d_frames[i].fdata = std::vector<float *>(nchannels, nullptr);
+		d_frames[i].fcapacity = 0;
+		d_frames[i].is_float = false;
+		d_frames[i].env_y.resize(nchannels);
+		d_frames[i].env_idx.resize(nchannels);
+		d_frames[i].env_size = 0;
+	}
+}
+
+FrameRing::~FrameRing()
+{
+	for (int i = 0; i < 3; i++)
+		for (unsigned int n = 0; n < d_nchannels; n++) {
+			volk_free(d_frames[i].data[n]);
+			volk_free(d_frames[i].fdata[n]);
+		}
+
+	volk_free(d_env_scratch);
+}
+
+unsigned int FrameRing::channelCount() const
+{
+	return d_nchannels;
+}
+
+void FrameRing::reserve(Frame& frame, size_t size, bool use_float)
+{
+	if (use_float) {
+		if (size <= frame.fcapacity)
+			return;
+
+		for (unsigned int n = 0; n < d_nchannels; n++) {
+			volk_free(frame.fdata[n]);
+			frame.fdata[n] = (float *)volk_malloc(
+				size * sizeof(float), volk_get_alignment());
+			memset(frame.fdata[n], 0, size * sizeof(float));
+		}
+
+		frame.fcapacity = size;
+		return;
+	}
+
+	if (size <= frame.capacity)
+		return;
+
+	for (unsigned int n = 0; n < d_nchannels; n++) {
+		volk_free(frame.data[n]);
+		frame.data[n] = (double *)volk_malloc(size * sizeof(double),
+			volk_get_alignment());
+		memset(frame.data[n], 0, size * sizeof(double));
+	}
+
+	frame.capacity = size;
+}
+
+Frame *FrameRing::back(size_t size, bool use_float)
+{
+	Frame *frame = &d_frames[d_back];
+
+	reserve(*frame, size, use_float);
+	frame->size = size;
+	frame->is_float = use_float;
+
+	size_t columns = d_env_columns.load(std::memory_order_relaxed);
+	if (columns > 0 && size >= columns * MIN_SAMPLES_PER_COLUMN)
+		frame->env_size = 2 * columns;
+	else
+		frame->env_size = 0;
+
+	return frame;
+}
+
+void FrameRing::fillEnvelope(Frame *frame, unsigned int chn, const float *in)
+{
+	size_t columns = frame->env_size / 2;
+
+	if (columns == 0)
+		return;
+
+	if (d_env_scratch_size < frame->size) {
+		volk_free(d_env_scratch);
+		d_env_scratch = (float *)volk_malloc(
+			frame->size * sizeof(float), volk_get_alignment());
+		d_env_scratch_size = frame->size;
+	}
+
+	// The minimum of a column is the maximum of its negated samples, so
+	// both extremes are found with the same vectorized index kernel.
+	volk_32f_s32f_multiply_32f(d_env_scratch, in, -1.0f, frame->size);
+
+	std::vector<double>& env_y = frame->env_y[chn];
+	std::vector<unsigned int>& env_idx = frame->env_idx[chn];
+	env_y.resize(2 * columns);
+	env_idx.resize(2 * columns);
+
+	for (size_t c = 0; c < columns; c++) {
+		uint32_t begin = c * frame->size / columns;
+		uint32_t end = (c + 1) * frame->size / columns;
+		uint32_t max_idx, min_idx;
+
+		volk_32f_index_max_32u(&max_idx, &in[begin], end - begin);
+		volk_32f_index_max_32u(&min_idx, &d_env_scratch[begin],
+			end - begin);
+		max_idx += begin;
+		min_idx += begin;
+
+		// Keep the points in time order so the curve shape is kept
+		uint32_t first = std::min(min_idx, max_idx);
+		uint32_t second = std::max(min_idx, max_idx);
+
+		env_idx[2 * c] = first;
+		env_y[2 * c] = in[first];
+		env_idx[2 * c + 1] = second;
+		env_y[2 * c + 1] = in[second];
+	}
+}
+
+void FrameRing::publish()
+{
+	int prev = d_middle.exchange(d_back | FRESH,
+		std::memory_order_acq_rel);
+
+	d_back = prev & INDEX_MASK;
+}
+
+bool FrameRing::consume()
+{
+	if (!(d_middle.load(std::memory_order_acquire) & FRESH))
+		return false;
+
+	int prev = d_middle.exchange(d_front, std::memory_order_acq_rel);
+	d_front = prev & INDEX_MASK;
+
+	return true;
+}
+
+Frame *FrameRing::front()
+{
+	return &d_frames[d_front];
+}
+
+void FrameRing::setEnvelopeColumns(unsigned int columns)
+{
+	d_env_columns.store(columns, std::memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FRAME_RING_HPP
+#define FRAME_RING_HPP
+
+#include <atomic>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <gnuradio/tags.h>
+
+namespace adiscope {
+
+	struct Frame {
+		std::vector<double *> data;
+		std::vector< std::vector<gr::tag_t> > tags;
+		size_t size;
+		size_t capacity;
+
+		/*
+		 * Single precision samples, used instead of data when the
+		 * frame was requested with use_float. Consumers that only
+		 * need float (e.g. the FFT plot) avoid both the conversion to
+		 * double and twice the memory traffic.
+		 */
+		std::vector<float *> fdata;
+		size_t fcapacity;
+		bool is_float;
+
+		/*
+		 * Min/max envelope of each channel: two points per column,
+		 * in the order they occur in the data. env_idx holds the
+		 * sample index of each point. env_size is 0 when the frame
+		 * is too short to be worth decimating.
+		 */
+		std::vector< std::vector<double> > env_y;
+		std::vector< std::vector<unsigned int> > env_idx;
+		size_t env_size;
+	};
+
+	/*
+	 * Triple buffer used to hand complete frames from a GNU Radio sink to
+	 * the GUI thread. The producer always owns the back frame and the
+	 * consumer always owns the front frame; the middle frame is exchanged
+	 * atomically, so neither side ever waits for or overwrites the other.
+	 */
+	class FrameRing
+	{
+	public:
+		typedef boost::shared_ptr<FrameRing> sptr;
+
+		explicit FrameRing(unsigned int nchannels);
+		~FrameRing();
+
+		unsigned int channelCount() const;
+
+		/* Producer side (sink worker thread) */
+		Frame *back(size_t size, bool use_float = false);
+		void fillEnvelope(Frame *frame, unsigned int chn,
+			const float *in);
+		void publish();
+
+		/* Consumer side (GUI thread) */
+		bool consume();
+		Frame *front();
+		void setEnvelopeColumns(unsigned int columns);
+
+	private:
+		static const int FRESH = 0x4;
+		static const int INDEX_MASK = 0x3;
+
+		/* Don't bother building an envelope below this ratio */
+		static const unsigned int MIN_SAMPLES_PER_COLUMN = 4;
+
+		void reserve(Frame& frame, size_t size, bool use_float);
+
+		unsigned int d_nchannels;
+		Frame d_frames[3];
+		int d_back;
+		int d_front;
+		std::atomic<int> d_middle;
+
+		std::atomic<unsigned int> d_env_columns;
+		float *d_env_scratch;
+		size_t d_env_scratch_size;
+	};
+}
+
+#endif /* FRAME_RING_HPP */
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "frame_trim.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+#include <gnuradio/io_signature.h>
+
+using namespace adiscope;
+
+frame_trim::frame_trim(size_t itemsize, size_t frame_size, size_t skip) :
+	gr::block("frame_trim",
+			gr::io_signature::make(1, 1, itemsize),
+			gr::io_signature::make(1, 1, itemsize)),
+	d_itemsize(itemsize),
+	d_frame_size(frame_size),
+	d_skip(skip),
+	d_tag_key(pmt::intern("buffer_start")),
+	d_frame(frame_size * itemsize),
+	d_fill(0),
+	d_skip_left(0),
+	d_active(false)
+{
+	/* The tags are moved to the start of the output frames */
+	set_tag_propagation_policy(TPP_DONT);
+	set_output_multiple(frame_size);
+}
+
+int frame_trim::general_work(int noutput_items,
+		gr_vector_int &ninput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	const char *in = (const char *)input_items[0];
+	char *out = (char *)output_items[0];
+	uint64_t nread = nitems_read(0);
+	size_t nb_in = ninput_items[0];
+	size_t consumed = 0;
+	int produced = 0;
+
+	std::vector<gr::tag_t> tags;
+	get_tags_in_range(tags, 0, nread, nread + nb_in, d_tag_key);
+	std::sort(tags.begin(), tags.end(), gr::tag_t::offset_compare);
+	auto tag = tags.begin();
+
+	while (consumed < nb_in && produced + d_frame_size <=
+			(size_t)noutput_items) {
+		uint64_t offset = nread + consumed;
+
+		/* A new buffer starts here: drop the partial frame */
+		if (tag != tags.end() && tag->offset == offset) {
+			d_fill = 0;
+			d_skip_left = d_skip;
+			d_active = true;
+
+			while (tag != tags.end() && tag->offset == offset)
+				++tag;
+		}
+
+		size_t count = nb_in - consumed;
+		if (tag != tags.end())
+			count = std::min<size_t>(count, tag->offset - offset);
+
+		/* Past the frame, or before the first buffer: wait for the
+		 * next one */
+		if (!d_active) {
+			consumed += count;
+			continue;
+		}
+
+		if (d_skip_left) {
+			count = std::min(count, d_skip_left);
+			d_skip_left -= count;
+			consumed += count;
+			continue;
+		}
+
+		count = std::min(count, d_frame_size - d_fill);
+		memcpy(&d_frame[d_fill * d_itemsize], in + consumed * d_itemsize,
+				count * d_itemsize);
+		d_fill += count;
+		consumed += count;
+
+		if (d_fill < d_frame_size)
+			continue;
+
+		memcpy(out + produced * d_itemsize, d_frame.data(),
+				d_frame_size * d_itemsize);
+		add_item_tag(0, nitems_written(0) + produced, d_tag_key,
+				pmt::PMT_T);
+		produced += d_frame_size;
+		d_fill = 0;
+		d_active = false;
+	}
+
+	consume_each(consumed);
+	return produced;
+}
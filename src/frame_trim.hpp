@@ -0,0 +1,63 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef FRAME_TRIM_HPP
+#define FRAME_TRIM_HPP
+
+#include <vector>
+
+#include <gnuradio/block.h>
+
+namespace adiscope {
+	/*
+	 * Cuts one frame of frame_size items out of every acquisition
+	 * buffer, after dropping the first skip items of the buffer. This
+	 * gets rid of the start-up transient of a filter upstream, whose
+	 * history would otherwise hold the tail of the previous buffer,
+	 * which isn't contiguous with this one. The rest of the buffer is
+	 * dropped as well.
+	 *
+	 * The buffers are delimited by "buffer_start" tags, and each output
+	 * frame starts with one, so the frames can be picked up by a sink
+	 * triggering on that tag.
+	 */
+	class frame_trim : public gr::block
+	{
+	public:
+		frame_trim(size_t itemsize, size_t frame_size, size_t skip);
+
+		int general_work(int noutput_items,
+				gr_vector_int &ninput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		size_t d_itemsize;
+		size_t d_frame_size;
+		size_t d_skip;
+		pmt::pmt_t d_tag_key;
+
+		std::vector<char> d_frame;
+		size_t d_fill;
+		size_t d_skip_left;
+		bool d_active;
+	};
+}
+
+#endif /* FRAME_TRIM_HPP */
@@ -20,6 +20,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <string.h>
+#include <cmath>
 #include <fcntl.h>
 #include <vector>
 #include <iio.h>
@@ -30,6 +32,7 @@
 #include <QPushButton>
 #include <QTimer>
 #include <QFileDialog>
+#include <QPointer>
 #include <QFile>
 #include <QMessageBox>
 #include <QDateTime>
@@ -55,6 +58,7 @@
 #include "dynamicWidget.hpp"
 #include "config.h"
 #include "osc_export_settings.h"
+#include "text_exporter.hpp"
 
 /* Sigrok includes */
 #include <libsigrokcxx/libsigrokcxx.hpp>
@@ -612,11 +616,20 @@ QString LogicAnalyzer::saveToFile()
 
 	file.close();
 
+	/* The tool may be gone by the time the export is over */
+	QPointer<LogicAnalyzer> self(this);
+	exportSettings->enableExportButton(false);
+
 	if( separator != "" )
 		done = exportTabCsv(separator, filename);
 	else
 		done = exportVCD(filename, startRow, endRow);
 
+	if (!self)
+		return "";
+
+	exportSettings->enableExportButton(true);
+
 	if(paused)
 		startStop(true);
 
@@ -625,139 +638,135 @@ QString LogicAnalyzer::saveToFile()
 
 bool LogicAnalyzer::exportVCD(QString filename, QString startSep, QString endSep)
 {
-	uint64_t current_sample, prev_sample;
-	int current_bit, prev_bit, p;
-	QString timescaleFormat;
-	double timescale;
-	double timestamp;
-	bool timestamp_written = false;
-
-	QFile file(filename);
-	if( !file.open(QIODevice::Append)) {
+	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
+	if (!logic_data)
 		return false;
-	}
-
-	QTextStream out(&file);
 
-	/* Write the specific header */
-	if( active_plot_timebase < 1e-6 ) {
-		timescaleFormat = "ns";
-		timescale = 1e-9;
-	}
-	else if( active_plot_timebase < 1e-3 ) {
-		timescaleFormat = "us";
-		timescale = 1e-6;
-	}
-	else if( active_plot_timebase < 1 ) {
-		timescaleFormat = "ms";
-		timescale = 1e-3;
-	}
-	else {
-		timescaleFormat = "s";
-		timescale = 1;
-	}
+	shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
+	uint64_t sample_count = segment->get_sample_count();
+	double samplerate = main_win->session_.get_samplerate();
+	if (!sample_count || samplerate <= 0)
+		return false;
 
-	out << startSep << "timescale 1 " << timescaleFormat << endSep;
-	out << startSep << "scope module Scopy" << endSep;
-	int counter = 0;
+	/* Use the largest timescale that still represents every sample
+	 * exactly, so that the dump keeps the full resolution */
+	static const char *units[] = { "ps", "ns", "us", "ms", "s" };
+	static const char *factors[] = { "1", "10", "100" };
+	uint64_t period_ps = llround(1e12 / samplerate);
+	bool exact = period_ps > 0 &&
+		std::fabs(period_ps - 1e12 / samplerate) < 1e-6 * period_ps;
+	unsigned int scale = 0;
+	uint64_t scale_ps = 1;
+
+	while (exact && scale < 14 && period_ps % (scale_ps * 10) == 0) {
+		scale++;
+		scale_ps *= 10;
+	}
+	const double samples_to_time = 1e12 / samplerate / scale_ps;
+
+	QString header;
+	header += startSep + "timescale " + factors[scale % 3] + " " +
+		units[scale / 3] + endSep;
+	header += startSep + "scope module Scopy" + endSep;
+
+	std::vector<int> channels;
+	uint64_t mask = 0;
 	for(int ch = 0; ch < no_channels; ch++) {
 		if( exportConfig[ch] ) {
-			char c = '!' + counter;
-			out << startSep << "var wire 1" << c << " DIO" <<
-			       QString::number(ch) << endSep;
-			counter++;
+			char c = '!' + channels.size();
+			header += startSep + "var wire 1 " + c + " DIO" +
+				QString::number(ch) + endSep;
+			channels.push_back(ch);
+			mask |= 1ULL << ch;
 		}
 	}
-	out << startSep << "upscope" << endSep;
-	out << startSep << "enddefinitions" << endSep;
+	header += startSep + "upscope" + endSep;
+	header += startSep + "enddefinitions" + endSep;
+
+	/* Only the transitions are visited; the segment's mip map is used
+	 * to skip over the idle parts of the capture */
+	return TextExporter::exportWithProgress(this, filename,
+		header.toUtf8(), sample_count,
+		[&](TextBuffer& buf, uint64_t first, uint64_t count) {
+		const uint64_t end = first + count;
+		uint64_t index = first;
+
+		if (first == 0) {
+			uint64_t sample = segment->get_sample(0);
+
+			buf.append("#0", 2);
+			for (unsigned int c = 0; c < channels.size(); c++) {
+				buf.append(' ');
+				buf.append('0' + ((sample >> channels[c]) & 1));
+				buf.append('!' + c);
+			}
+			buf.append('\n');
+			index = 1;
+		}
 
-	/* Write the values */
-	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
-	if(logic_data) {
-		shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
-		uint64_t sample_count = segment->get_sample_count();
-		for(int i = 0; i < sample_count; i++) {
-			current_sample = segment->get_sample(i);
-			if( i == 0)
-				prev_sample = current_sample;
-			else
-				prev_sample = segment->get_sample(i-1);
-			timestamp_written = false;
-			p = 0;
-			timestamp = ((i * active_plot_timebase * 10) / sample_count)/timescale;
-
-			for(int ch = 0; ch < no_channels; ch++) {
-				current_bit = (current_sample >> ch) & 1;
-				prev_bit = (prev_sample >> ch) & 1;
-
-				if((current_bit == prev_bit) && (i != 0))
-					continue;
+		while ((index = segment->find_next_edge(index, end, mask)) < end) {
+			uint64_t sample = segment->get_sample(index);
+			uint64_t changed = (sample ^ segment->get_sample(index - 1))
+				& mask;
 
-				if( !timestamp_written )
-					out << "#" << QString::number(timestamp);
+			buf.append('#');
+			buf.appendUInt(llround(index * samples_to_time));
+			for (unsigned int c = 0; c < channels.size(); c++) {
+				if (!((changed >> channels[c]) & 1))
+					continue;
 
-				if(exportConfig[ch]) {
-					char c = '0' + current_bit;
-					char c2 = '!' + p;
-					out << ' ' << c << c2;
-					p++;
-					timestamp_written = true;
-				}
+				buf.append(' ');
+				buf.append('0' + ((sample >> channels[c]) & 1));
+				buf.append('!' + c);
 			}
-			if(timestamp_written)
-				out << "\n";
+			buf.append('\n');
+			index++;
 		}
-	}
-	else {
-		file.close();
-		return false;
-	}
-	file.close();
-	return true;
+	}, true);
 }
 
 bool LogicAnalyzer::exportTabCsv(QString separator, QString filename)
 {
-	QFile file(filename);
-	if( !file.open(QIODevice::Append)) {
+	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
+	if (!logic_data)
 		return false;
-	}
-
-	QTextStream out(&file);
 
 	// Write the header ( sample number + channels)
+	QStringList columns;
+	std::vector<int> channels;
 	for(int ch = 0; ch < no_channels; ch++) {
 		if( exportConfig[ch] ) {
-			out << "Channel " + QString::number(ch) +
-			       ((ch == no_channels - 1) ? "\n" : separator);
+			columns << "Channel " + QString::number(ch);
+			channels.push_back(ch);
 		}
-		else if( ch == no_channels - 1)
-			out << "\n";
 	}
-
-	// Write the values
-	std::shared_ptr<pv::data::Logic> logic_data = main_win->session_.get_logic_data();
-	if(logic_data) {
-		shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
-		for(int i = 0; i < segment->get_sample_count(); i++) {
-			uint64_t sample = segment->get_sample(i);
-			for(int ch = 0; ch < no_channels; ch++) {
-				int bit = (sample >> ch) & 1;
-				if(exportConfig[ch]) {
-					out << (bit ? "1" : "0");
-					out << ((ch == no_channels - 1) ? "\n" : separator);
-				}
-				else if( ch == no_channels - 1)
-					out << "\n";
+	QByteArray header = (columns.join(separator) + "\n").toUtf8();
+
+	// Write the values, fetching whole blocks of samples at once instead
+	// of locking the segment for every sample
+	shared_ptr<pv::data::LogicSegment> segment = logic_data->logic_segments().front();
+	const unsigned int unit_size = segment->unit_size();
+	const char sep = separator.at(0).toLatin1();
+	std::vector<uint8_t> block;
+
+	return TextExporter::exportWithProgress(this, filename, header,
+		segment->get_sample_count(),
+		[&](TextBuffer& buf, uint64_t first, uint64_t count) {
+		block.resize(count * unit_size);
+		segment->get_samples(block.data(), first, first + count);
+
+		for (uint64_t i = 0; i < count; i++) {
+			uint64_t sample = 0;
+			memcpy(&sample, &block[i * unit_size], unit_size);
+
+			for (unsigned int c = 0; c < channels.size(); c++) {
+				if (c)
+					buf.append(sep);
+				buf.append('0' + ((sample >> channels[c]) & 1));
 			}
+			buf.append('\n');
 		}
-	}
-	else {
-		file.close();
-		return false;
-	}
-	file.close();
-	return true;
+	}, true);
 }
 
 void LogicAnalyzer::btnExportPressed()
@@ -19,10 +19,13 @@
 
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
 #include <QSettings>
 #include <QtGlobal>
 
 #include "config.h"
+#include "fft_plan_cache.hpp"
 #include "tool_launcher.hpp"
 
 using namespace adiscope;
@@ -53,6 +56,12 @@ int main(int argc, char **argv)
 	QCoreApplication::setApplicationVersion(SCOPY_VERSION_GIT);
 	QSettings::setDefaultFormat(QSettings::IniFormat);
 
+	/* Keep the FFTW wisdom next to the settings */
+	QString settings_dir = QFileInfo(QSettings().fileName()).absolutePath();
+	QDir().mkpath(settings_dir);
+	fft_plan_cache::set_wisdom_file(QDir(settings_dir)
+			.filePath("fftw_wisdom").toStdString());
+
 	QCommandLineParser parser;
 
 	parser.addHelpOption();
@@ -21,6 +21,7 @@
 #include "adc_sample_conv.hpp"
 #include <qmath.h>
 #include <QDebug>
+#include <algorithm>
 
 using namespace adiscope;
 
@@ -226,6 +227,48 @@ namespace adiscope {
 			}
 		}
 
+		void reset(double level, double hysteresis_span)
+		{
+			m_level = level;
+			m_hysteresis_span = hysteresis_span;
+			m_low_level = level - hysteresis_span / 2;
+			m_high_level = level + hysteresis_span / 2;
+			m_posCrossFound = false;
+			m_negCrossFound = false;
+			m_posCross.resetState();
+			m_negCross.resetState();
+			m_detectedCrossings.clear();
+		}
+
+		bool isBetweenThresholds()
+		{
+			return m_posCross.isBetweenThresholds() ||
+				m_negCross.isBetweenThresholds();
+		}
+
+		/*
+		 * Return the first index >= i at which data[idx - 1], data[idx]
+		 * touch one of the hysteresis thresholds. While neither
+		 * detector sits between the thresholds, crossDetectStep() has
+		 * nothing to do for the samples in between, so they can be
+		 * skipped with this tight scan.
+		 */
+		inline size_t nextCrossing(const double *data, size_t i,
+				size_t length) const
+		{
+			for (; i < length; i++) {
+				double lo = std::min(data[i - 1], data[i]);
+				double hi = std::max(data[i - 1], data[i]);
+
+				if (lo != hi &&
+					((lo <= m_low_level && hi >= m_low_level) ||
+					(lo <= m_high_level && hi >= m_high_level)))
+					break;
+			}
+
+			return i;
+		}
+
 		void setExternalList(QList<CrossPoint> *externList)
 		{
 			m_externList = externList;
@@ -341,6 +384,84 @@ namespace adiscope {
 	};
 }
 
+/*
+ * Min, max, sum and sum of squares of a buffer along with its ADC code
+ * histogram, all gathered in a single sweep. Four independent accumulators
+ * are used so that consecutive samples don't wait on each other. Without
+ * a histogram, the compiler is also free to vectorize the reductions.
+ */
+struct BufferStats {
+	double min;
+	double max;
+	double sum;
+	double sqr_sum;
+};
+
+template <bool with_hist>
+static void sweep_buffer(const double *data, size_t length, int *hist,
+		int adc_span, double volts_to_raw, BufferStats& stats)
+{
+	const int hlf_scale = adc_span / 2;
+	double mn[4], mx[4], sum[4], sqr[4];
+	size_t i;
+
+	for (int k = 0; k < 4; k++) {
+		mn[k] = data[0];
+		mx[k] = data[0];
+		sum[k] = 0;
+		sqr[k] = 0;
+	}
+
+	for (i = 0; i + 4 <= length; i += 4) {
+		for (int k = 0; k < 4; k++) {
+			double v = data[i + k];
+
+			mn[k] = std::min(mn[k], v);
+			mx[k] = std::max(mx[k], v);
+			sum[k] += v;
+			sqr[k] += v * v;
+
+			if (with_hist) {
+				int raw = hlf_scale + (int)(float)(v * volts_to_raw);
+
+				if (raw >= 0 && raw < adc_span)
+					hist[raw] += 1;
+			}
+		}
+	}
+	for (; i < length; i++) {
+		double v = data[i];
+
+		mn[0] = std::min(mn[0], v);
+		mx[0] = std::max(mx[0], v);
+		sum[0] += v;
+		sqr[0] += v * v;
+
+		if (with_hist) {
+			int raw = hlf_scale + (int)(float)(v * volts_to_raw);
+
+			if (raw >= 0 && raw < adc_span)
+				hist[raw] += 1;
+		}
+	}
+
+	stats.min = std::min(std::min(mn[0], mn[1]), std::min(mn[2], mn[3]));
+	stats.max = std::max(std::max(mx[0], mx[1]), std::max(mx[2], mx[3]));
+	stats.sum = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+	stats.sqr_sum = (sqr[0] + sqr[1]) + (sqr[2] + sqr[3]);
+}
+
+static void compute_buffer_stats(const double *data, size_t length,
+		int *hist, int adc_span, double volts_to_raw, BufferStats& stats)
+{
+	if (hist)
+		sweep_buffer<true>(data, length, hist, adc_span,
+				volts_to_raw, stats);
+	else
+		sweep_buffer<false>(data, length, hist, adc_span,
+				volts_to_raw, stats);
+}
+
 Measure::Measure(int channel, double *buffer, size_t length):
 	m_channel(channel),
 	m_buffer(buffer),
@@ -348,7 +469,8 @@ Measure::Measure(int channel, double *buffer, size_t length):
 	m_sample_rate(1.0),
 	m_adc_bit_count(0),
 	m_cross_level(0),
-	m_hysteresis_span(0)
+	m_hysteresis_span(0),
+	m_cross_detect(new CrossingDetection(0, 0, "P"))
 {
 
 	// Create a set of measurements
@@ -403,11 +525,16 @@ Measure::Measure(int channel, double *buffer, size_t length):
 
 }
 
+/* Defined here, where CrossingDetection is complete */
+Measure::~Measure()
+{
+}
+
 bool Measure::highLowFromHistogram(double &low, double &high,
 		double min, double max)
 {
 	bool success = false;
-	int *hist = m_histogram;
+	int *hist = m_histogram.data();
 	int adc_span = 1 << m_adc_bit_count;
 	int hlf_scale = adc_span / 2;
 
@@ -447,6 +574,16 @@ void Measure::setDataSource(double *buffer, size_t length)
 	m_buf_length = length;
 }
 
+double *Measure::dataSource() const
+{
+	return m_buffer;
+}
+
+size_t Measure::dataLength() const
+{
+	return m_buf_length;
+}
+
 void Measure::measure()
 {
 	clearMeasurements();
@@ -489,41 +626,30 @@ void Measure::measure()
 	int hlf_scale = adc_span / 2;
 	bool using_histogram_method = (adc_span > 1);
 
-	max = data[0];
-	min = data[0];
-	sum = data[0];
-	sqr_sum = data[0] * data[0];
-	m_cross_detect = new CrossingDetection(m_cross_level, m_hysteresis_span,
-			"P");
 	if (using_histogram_method)
-		m_histogram = new int[adc_span]{};
-
+		std::fill(m_histogram.begin(), m_histogram.end(), 0);
+
+	// Min, Max, Sum, Sum of squares and histogram in one sweep
+	BufferStats stats;
+	compute_buffer_stats(data, data_length,
+		using_histogram_method ? m_histogram.data() : NULL, adc_span,
+		adc_sample_conv::convVoltsToSample(1.0), stats);
+	min = stats.min;
+	max = stats.max;
+	sum = stats.sum;
+	sqr_sum = stats.sqr_sum;
+
+	// Find level crossings (period detection). Only the samples around
+	// the thresholds are fed to the detector.
+	m_cross_detect->reset(m_cross_level, m_hysteresis_span);
 	for (size_t i = 1; i < data_length; i++) {
+		if (!m_cross_detect->isBetweenThresholds()) {
+			i = m_cross_detect->nextCrossing(data, i, data_length);
+			if (i == data_length)
+				break;
+		}
 
-		// Find level crossings (period detection)
 		m_cross_detect->crossDetectStep(data, i);
-
-		// Min
-		if (data[i] < min)
-			min = data[i];
-
-		// Max
-		if (data[i] > max)
-			max = data[i];
-
-		// Sum of values
-		sum += data[i];
-
-		// Sum of the squares of values
-		sqr_sum += data[i] * data[i];
-
-		// Build histogram
-		if (using_histogram_method) {
-			int raw = hlf_scale + (int)adiscope::adc_sample_conv::
-						convVoltsToSample(data[i]);
-			if (raw >= 0 && raw  < adc_span)
-				m_histogram[raw] += 1;
-		}
 	}
 
 	m_measurements[MIN]->setValue(min);
@@ -569,11 +695,6 @@ void Measure::measure()
 	overshoot_n = (low - min) / amplitude * 100;
 	m_measurements[N_OVER]->setValue(overshoot_n);
 
-	if (m_histogram != NULL) {
-		delete[] m_histogram;
-		m_histogram = NULL;
-	}
-
 	// Find Period / Frequency
 	QList<CrossPoint> periodPoints = m_cross_detect->detectedCrossings();
 	int n = periodPoints.size();
@@ -724,9 +845,6 @@ void Measure::measure()
 		}
 	}
 
-	delete m_cross_detect;
-	m_cross_detect = NULL;
-
 }
 
 double Measure::sampleRate()
@@ -747,6 +865,11 @@ unsigned int Measure::adcBitCount()
 void Measure::setAdcBitCount(unsigned int val)
 {
 	m_adc_bit_count = val;
+
+	if (val > 0)
+		m_histogram.resize(1 << val);
+	else
+		m_histogram.clear();
 }
 
 double Measure::crossLevel()
@@ -23,6 +23,7 @@
 #include <QList>
 #include <QString>
 #include <memory>
+#include <vector>
 
 namespace adiscope {
 	class CrossingDetection;
@@ -101,8 +102,11 @@ namespace adiscope {
 		};
 
 		Measure(int channel, double *buffer = NULL, size_t length = 0);
+		~Measure();
 
 		void setDataSource(double *buffer, size_t length);
+		double *dataSource() const;
+		size_t dataLength() const;
 		void measure();
 		double sampleRate();
 		void setSampleRate(double);
@@ -133,8 +137,8 @@ namespace adiscope {
 		double m_cross_level;
 		double m_hysteresis_span;
 
-		int *m_histogram;
-		CrossingDetection *m_cross_detect;
+		std::vector<int> m_histogram;
+		std::unique_ptr<CrossingDetection> m_cross_detect;
 
 		QList<std::shared_ptr<MeasurementData>> m_measurements;
 	};
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "measure_engine.hpp"
+#include "measure.h"
+
+#include <QtConcurrentRun>
+
+using namespace adiscope;
+
+MeasureEngine::MeasureEngine(QObject *parent) :
+	QObject(parent),
+	d_remaining(0),
+	d_sequence(0),
+	d_invalid_up_to(0)
+{
+}
+
+MeasureEngine::~MeasureEngine()
+{
+	d_pool.waitForDone();
+
+	for (int i = 0; i < d_workers.size(); i++)
+		delete d_workers[i];
+}
+
+void MeasureEngine::submit(const QList<Measure *>& measures)
+{
+	if (measures.isEmpty())
+		return;
+
+	std::unique_ptr<Batch> batch(new Batch);
+	batch->sequence = ++d_sequence;
+	batch->jobs.resize(measures.size());
+
+	for (int i = 0; i < measures.size(); i++) {
+		Job& job = batch->jobs[i];
+		const double *data = measures[i]->dataSource();
+
+		job.target = measures[i];
+		if (data)
+			job.data.assign(data, data + measures[i]->dataLength());
+	}
+
+	if (d_running)
+		d_pending = std::move(batch);
+	else
+		start(std::move(batch));
+}
+
+void MeasureEngine::invalidate()
+{
+	// Results of the batches submitted so far refer to Measure objects
+	// that may be gone by the time they finish.
+	d_invalid_up_to = d_sequence;
+	d_pending.reset();
+}
+
+bool MeasureEngine::busy() const
+{
+	return d_running || d_pending;
+}
+
+void MeasureEngine::start(std::unique_ptr<Batch> batch)
+{
+	unsigned int count = batch->jobs.size();
+
+	while (d_workers.size() < count)
+		d_workers.push_back(new Measure(-1));
+
+	// Each job runs on its own worker Measure, set up like its target
+	for (unsigned int i = 0; i < count; i++) {
+		Measure *target = batch->jobs[i].target;
+		Measure *worker = d_workers[i];
+
+		worker->setSampleRate(target->sampleRate());
+		worker->setCrossLevel(target->crossLevel());
+		worker->setHysteresisSpan(target->hysteresisSpan());
+		if (worker->adcBitCount() != target->adcBitCount())
+			worker->setAdcBitCount(target->adcBitCount());
+		worker->setDataSource(batch->jobs[i].data.data(),
+			batch->jobs[i].data.size());
+	}
+
+	d_running = std::move(batch);
+	d_remaining = count;
+
+	for (unsigned int i = 0; i < count; i++)
+		QtConcurrent::run(&d_pool, this, &MeasureEngine::run, i);
+}
+
+void MeasureEngine::run(unsigned int jobIdx)
+{
+	d_workers[jobIdx]->measure();
+
+	if (--d_remaining == 0)
+		QMetaObject::invokeMethod(this, "onBatchFinished",
+			Qt::QueuedConnection);
+}
+
+void MeasureEngine::onBatchFinished()
+{
+	std::unique_ptr<Batch> batch = std::move(d_running);
+
+	if (batch->sequence > d_invalid_up_to) {
+		for (unsigned int i = 0; i < batch->jobs.size(); i++) {
+			Measure *target = batch->jobs[i].target;
+			Measure *worker = d_workers[i];
+
+			for (int m = 0; m < Measure::DEFAULT_MEASUREMENT_COUNT;
+					m++) {
+				auto src = worker->measurement(m);
+				auto dst = target->measurement(m);
+
+				if (src->measured())
+					dst->setValue(src->value());
+				else
+					dst->setMeasured(false);
+			}
+		}
+
+		Q_EMIT measurementsReady(batch->sequence);
+	}
+
+	if (d_pending)
+		start(std::move(d_pending));
+}
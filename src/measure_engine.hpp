@@ -0,0 +1,87 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef MEASURE_ENGINE_HPP
+#define MEASURE_ENGINE_HPP
+
+#include <QList>
+#include <QObject>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace adiscope {
+	class Measure;
+
+	/*
+	 * Runs the measurements of several channels in parallel, off the GUI
+	 * thread. Each submitted batch snapshots the data of the channels, so
+	 * the plot is free to move on to the next frame right away. Only one
+	 * batch is computed at a time; a batch submitted meanwhile replaces
+	 * any other waiting batch, so stale frames are never measured.
+	 */
+	class MeasureEngine : public QObject
+	{
+		Q_OBJECT
+
+	public:
+		explicit MeasureEngine(QObject *parent = nullptr);
+		~MeasureEngine();
+
+		void submit(const QList<Measure *>& measures);
+		void invalidate();
+
+		/* Whether a batch is being measured or waiting to be */
+		bool busy() const;
+
+	Q_SIGNALS:
+		void measurementsReady(quint64 sequence);
+
+	private Q_SLOTS:
+		void onBatchFinished();
+
+	private:
+		struct Job {
+			Measure *target;
+			std::vector<double> data;
+		};
+
+		struct Batch {
+			quint64 sequence;
+			std::vector<Job> jobs;
+		};
+
+		void start(std::unique_ptr<Batch> batch);
+		void run(unsigned int jobIdx);
+
+		QThreadPool d_pool;
+		QList<Measure *> d_workers;
+
+		std::unique_ptr<Batch> d_running;
+		std::unique_ptr<Batch> d_pending;
+		std::atomic<int> d_remaining;
+
+		quint64 d_sequence;
+		quint64 d_invalid_up_to;
+	};
+}
+
+#endif /* MEASURE_ENGINE_HPP */
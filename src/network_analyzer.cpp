@@ -23,30 +23,13 @@
 #include "spinbox_a.hpp"
 #include "osc_adc.h"
 #include "hardware_trigger.hpp"
+#include "single_bin_dft.hpp"
 #include "ui_network_analyzer.h"
 
-#include <gnuradio/analog/sig_source_c.h>
-#include <gnuradio/analog/sig_source_f.h>
-#include <gnuradio/analog/sig_source_waveform.h>
-#include <gnuradio/blocks/complex_to_arg.h>
-#include <gnuradio/blocks/complex_to_mag_squared.h>
-#include <gnuradio/blocks/float_to_short.h>
-#include <gnuradio/blocks/head.h>
-#include <gnuradio/blocks/moving_average_cc.h>
-#include <gnuradio/blocks/multiply_cc.h>
-#include <gnuradio/blocks/multiply_conjugate_cc.h>
-#include <gnuradio/blocks/null_sink.h>
-#include <gnuradio/blocks/null_source.h>
-#include <gnuradio/blocks/rotator_cc.h>
-#include <gnuradio/blocks/skiphead.h>
-#include <gnuradio/blocks/vector_sink_f.h>
-#include <gnuradio/blocks/vector_sink_s.h>
-#include <gnuradio/top_block.h>
-
-#include <boost/make_shared.hpp>
-
 #include <QDebug>
-#include <QThread>
+
+#include <algorithm>
+#include <cmath>
 
 #include <iio.h>
 
@@ -64,7 +47,8 @@ NetworkAnalyzer::NetworkAnalyzer(struct iio_context *ctx, Filter *filt,
 		ToolLauncher *parent) :
 	Tool(ctx, runButton, new NetworkAnalyzer_API(this), "Network Analyzer", parent),
 	ui(new Ui::NetworkAnalyzer),
-	adc_dev(adc_dev)
+	adc_dev(adc_dev),
+	stop(true)
 {
 	iio = iio_manager::get_instance(ctx,
 			filt->device_name(TOOL_NETWORK_ANALYZER, 2));
@@ -204,7 +188,46 @@ void NetworkAnalyzer::run()
 	else
 		step = (max_freq - min_freq) / (double)(steps - 1);
 
-	for (unsigned int i = 0; !stop && i < steps; i++) {
+	/* The analysis block is connected once, and retuned at every step
+	 * of the sweep, so that the flowgraph doesn't have to be restarted */
+	bool started = iio->started();
+	if (started)
+		iio->lock();
+
+	/* Both channels are analyzed by a single block, straight from the
+	 * raw samples */
+	auto dft = gnuradio::get_initial_sptr(new single_bin_dft());
+	auto id1 = iio->connect(dft, 0, 0);
+	auto id2 = iio->connect(dft, 1, 1);
+
+	if (started)
+		iio->unlock();
+
+	bool got_it = false, cancelled = false;
+	float mag1 = 0.0f, mag2 = 0.0f, phase = 0.0f;
+
+	connect(&*dft, &single_bin_dft::sampled,
+			[&](const std::vector<float> values) {
+		std::unique_lock<std::mutex> lock(step_mutex);
+
+		mag1 = values[0];
+		mag2 = values[1];
+		phase = values[2];
+		got_it = true;
+		lock.unlock();
+
+		step_cond.notify_one();
+	});
+
+	/* Querying the available rates is slow, do it once per sweep */
+	QVector<unsigned long> dac_rates =
+		SignalGenerator::get_available_sample_rates(dev1);
+	QVector<unsigned long> adc_rates =
+		SignalGenerator::get_available_sample_rates(adc);
+	double amplitude = ui->amplitude->value();
+	double offset = ui->offset->value();
+
+	auto prepare = [=](unsigned int i) {
 		double frequency;
 
 		if (is_log) {
@@ -214,146 +237,95 @@ void NetworkAnalyzer::run()
 			frequency = min_freq + (double) i * step;
 		}
 
-		unsigned long rate = get_best_sample_rate(dev1, frequency);
-		size_t samples_count = get_sin_samples_count(
-				dev1, rate, frequency);
-		unsigned long adc_rate;
+		return prepareStep(dev1, adc, dac_rates, adc_rates,
+				frequency, amplitude, offset);
+	};
 
-		double amplitude = ui->amplitude->value();
-		double offset = ui->offset->value();
+	struct iio_buffer *buf_dac1 = nullptr, *buf_dac2 = nullptr;
+	unsigned long dac_rate = 0, adc_rate = 0;
+	size_t buffer_size = 0;
+	QFuture<SweepStep> next;
 
-		if (dev1 != dev2)
-			iio_device_attr_write_bool(dev1, "dma_sync", true);
+	if (steps)
+		next = QtConcurrent::run(prepare, 0);
+
+	for (unsigned int i = 0; !stop && i < steps; i++) {
+		SweepStep cur;
 
-		struct iio_buffer *buf_dac1 = generateSinWave(dev1,
-				frequency, amplitude, offset,
-				rate, samples_count);
-		if (!buf_dac1) {
-			qCritical() << "Unable to create DAC buffer";
+		try {
+			cur = next.result();
+		} catch (const std::exception& e) {
+			qCritical() << e.what();
 			break;
 		}
 
-		struct iio_buffer *buf_dac2 = nullptr;
+		/* Compute the next step while this one is acquiring */
+		if (i + 1 < steps)
+			next = QtConcurrent::run(prepare, i + 1);
+
+		/* Only one buffer can exist at a time on each DAC */
+		if (buf_dac1) {
+			iio_buffer_destroy(buf_dac1);
+			buf_dac1 = nullptr;
+		}
+		if (buf_dac2) {
+			iio_buffer_destroy(buf_dac2);
+			buf_dac2 = nullptr;
+		}
 
-		if (dev1 != dev2) {
-			buf_dac2 = generateSinWave(dev2, frequency, amplitude,
-					offset, rate, samples_count);
-			if (!buf_dac2) {
-				qCritical() << "Unable to create DAC buffer";
-				break;
-			}
+		if (dev1 != dev2)
+			iio_device_attr_write_bool(dev1, "dma_sync", true);
 
-			iio_device_attr_write_bool(dev1, "dma_sync", false);
+		try {
+			buf_dac1 = pushSinWave(dev1, cur.dac_samples,
+					cur.dac_rate, cur.dac_rate != dac_rate);
+
+			if (dev1 != dev2)
+				buf_dac2 = pushSinWave(dev2, cur.dac_samples,
+						cur.dac_rate,
+						cur.dac_rate != dac_rate);
+		} catch (const std::exception& e) {
+			qCritical() << e.what();
+			if (dev1 != dev2)
+				iio_device_attr_write_bool(dev1,
+						"dma_sync", false);
+			break;
 		}
 
-		adc_rate = get_best_sample_rate(adc, frequency);
-		iio_device_attr_write_longlong(adc,
-				"sampling_frequency", adc_rate);
-
-		/* Lock the flowgraph if we are already started */
-		bool started = iio->started();
-		if (started)
-			iio->lock();
-
-		size_t buffer_size = get_sin_samples_count(
-				adc, adc_rate, frequency);
-
-		auto f2c1 = blocks::float_to_complex::make();
-		auto f2c2 = blocks::float_to_complex::make();
-		auto id1 = iio->connect(f2c1, 0, 0, true,
-				buffer_size);
-		auto id2 = iio->connect(f2c2, 1, 0, true,
-				buffer_size);
-
-		auto null = blocks::null_source::make(sizeof(float));
-		iio->connect(null, 0, f2c1, 1);
-		iio->connect(null, 0, f2c2, 1);
-
-		auto cosine = analog::sig_source_c::make(
-				(unsigned int) adc_rate,
-				gr::analog::GR_COS_WAVE, -frequency, 1.0);
-
-		auto mult1 = blocks::multiply_cc::make();
-		iio->connect(f2c1, 0, mult1, 0);
-		iio->connect(cosine, 0, mult1, 1);
-
-		auto mult2 = blocks::multiply_cc::make();
-		iio->connect(f2c2, 0, mult2, 0);
-		iio->connect(cosine, 0, mult2, 1);
-
-		auto signal = boost::make_shared<signal_sample>();
-		auto conj = blocks::multiply_conjugate_cc::make();
-
-		auto avg1 = blocks::moving_average_cc::make(buffer_size,
-				2.0 / buffer_size, buffer_size);
-		auto skiphead3 = blocks::skiphead::make(sizeof(gr_complex),
-				buffer_size - 1);
-		auto c2m1 = blocks::complex_to_mag_squared::make();
-
-		iio->connect(mult1, 0, avg1, 0);
-		iio->connect(avg1, 0, skiphead3, 0);
-		iio->connect(skiphead3, 0, c2m1, 0);
-		iio->connect(skiphead3, 0, conj, 0);
-		iio->connect(c2m1, 0, signal, 0);
-
-		auto avg2 = blocks::moving_average_cc::make(buffer_size,
-				2.0 / buffer_size, buffer_size);
-		auto skiphead4 = blocks::skiphead::make(sizeof(gr_complex),
-				buffer_size - 1);
-		auto c2m2 = blocks::complex_to_mag_squared::make();
-
-		iio->connect(mult2, 0, avg2, 0);
-		iio->connect(avg2, 0, skiphead4, 0);
-		iio->connect(skiphead4, 0, c2m2, 0);
-		iio->connect(skiphead4, 0, conj, 1);
-		iio->connect(c2m2, 0, signal, 1);
-
-		auto c2a = blocks::complex_to_arg::make();
-		iio->connect(conj, 0, c2a, 0);
-		iio->connect(c2a, 0, signal, 2);
-
-		bool got_it = false;
-		float mag1 = 0.0f, mag2 = 0.0f, phase = 0.0f;
-
-		connect(&*signal, &signal_sample::triggered,
-				[&](const std::vector<float> values) {
-			mag1 = values[0];
-			mag2 = values[1];
-			phase = values[2];
-			got_it = true;
-		});
+		if (dev1 != dev2)
+			iio_device_attr_write_bool(dev1, "dma_sync", false);
 
-		iio->start(id1);
-		iio->start(id2);
+		dac_rate = cur.dac_rate;
 
-		if (started)
-			iio->unlock();
+		/* Writing attributes is slow, only do it on changes */
+		if (cur.adc_rate != adc_rate) {
+			adc_rate = cur.adc_rate;
+			iio_device_attr_write_longlong(adc,
+					"sampling_frequency", adc_rate);
+		}
 
-		do {
-			QCoreApplication::processEvents();
-			QThread::msleep(10);
+		if (cur.adc_buffer_size != buffer_size) {
+			buffer_size = cur.adc_buffer_size;
+			iio->set_buffer_size(id1, buffer_size);
+			iio->set_buffer_size(id2, buffer_size);
+		}
 
-			if (!ui->run_button->isChecked())
-				break;
-		} while (!got_it);
+		double frequency = cur.frequency;
 
-		iio->stop(id1);
-		iio->stop(id2);
+		got_it = false;
+		dft->arm(frequency, adc_rate, buffer_size, STALE_BUFFERS);
 
-		started = iio->started();
-		if (started)
-			iio->lock();
-		iio->disconnect(id1);
-		iio->disconnect(id2);
-		if (started)
-			iio->unlock();
+		iio->start(id1);
+		iio->start(id2);
 
-		iio_buffer_destroy(buf_dac1);
-		if (buf_dac2)
-			iio_buffer_destroy(buf_dac2);
+		std::unique_lock<std::mutex> lock(step_mutex);
+		step_cond.wait(lock, [&]() { return got_it || stop; });
+		lock.unlock();
 
-		if (!got_it) /* Process was cancelled */
-			return;
+		if (!got_it) { /* Process was cancelled */
+			cancelled = true;
+			break;
+		}
 
 		double mag;
 		if (ui->refCh1->isChecked()) {
@@ -394,12 +366,36 @@ void NetworkAnalyzer::run()
 				 Q_ARG(double, mag));
 	}
 
-	Q_EMIT sweepDone();
+	next.waitForFinished();
+
+	dft->disarm();
+	iio->stop(id1);
+	iio->stop(id2);
+
+	started = iio->started();
+	if (started)
+		iio->lock();
+	iio->disconnect(id1);
+	iio->disconnect(id2);
+	if (started)
+		iio->unlock();
+
+	if (buf_dac1)
+		iio_buffer_destroy(buf_dac1);
+	if (buf_dac2)
+		iio_buffer_destroy(buf_dac2);
+
+	if (!cancelled)
+		Q_EMIT sweepDone();
 }
 
 void NetworkAnalyzer::startStop(bool pressed)
 {
-	stop = !pressed;
+	{
+		std::unique_lock<std::mutex> lock(step_mutex);
+		stop = !pressed;
+	}
+	step_cond.notify_all();
 
 	if (amp1 && amp2) {
 		/* FIXME: TODO: Move this into a HW class / lib M2k */
@@ -454,13 +450,11 @@ size_t NetworkAnalyzer::get_sin_samples_count(const struct iio_device *dev,
 }
 
 unsigned long NetworkAnalyzer::get_best_sample_rate(
-		const struct iio_device *dev, double frequency)
+		const struct iio_device *dev,
+		const QVector<unsigned long>& rates, double frequency)
 {
-	QVector<unsigned long> values =
-		SignalGenerator::get_available_sample_rates(dev);
-
 	/* Return the best sample rate that we can create a buffer for */
-	for (unsigned long rate : values) {
+	for (unsigned long rate : rates) {
 		size_t buf_size = get_sin_samples_count(dev, rate, frequency);
 		if (buf_size)
 			return rate;
@@ -472,53 +466,72 @@ unsigned long NetworkAnalyzer::get_best_sample_rate(
 	throw std::runtime_error("Unable to calculate best sample rate");
 }
 
-struct iio_buffer * NetworkAnalyzer::generateSinWave(
-		const struct iio_device *dev, double frequency,
+NetworkAnalyzer::SweepStep NetworkAnalyzer::prepareStep(
+		const struct iio_device *dac, const struct iio_device *adc,
+		const QVector<unsigned long>& dac_rates,
+		const QVector<unsigned long>& adc_rates,
+		double frequency, double amplitude, double offset)
+{
+	SweepStep step;
+
+	step.frequency = frequency;
+	step.dac_rate = get_best_sample_rate(dac, dac_rates, frequency);
+	step.adc_rate = get_best_sample_rate(adc, adc_rates, frequency);
+	step.adc_buffer_size = get_sin_samples_count(adc, step.adc_rate,
+			frequency);
+	step.dac_samples = generateSinWave(frequency, amplitude, offset,
+			step.dac_rate, get_sin_samples_count(dac,
+				step.dac_rate, frequency));
+
+	return step;
+}
+
+std::vector<short> NetworkAnalyzer::generateSinWave(double frequency,
 		double amplitude, double offset,
 		unsigned long rate, size_t samples_count)
 {
-	/* Create the IIO buffer */
-	struct iio_buffer *buf = iio_device_create_buffer(
-			dev, samples_count, true);
-	if (!buf)
-		throw std::runtime_error("Unable to create buffer");
-
-	auto top_block = gr::make_top_block("Signal Generator");
-
-	auto src = analog::sig_source_f::make(rate, analog::GR_SIN_WAVE,
-			frequency, amplitude / 2.0, offset);
+	std::vector<short> samples(samples_count);
 
 	// DAC_RAW = (-Vout * 2^11) / 5V
 	// Multiplying with 16 because the HDL considers the DAC data as 16 bit
 	// instead of 12 bit(data is shifted to the left).
-	auto f2s = blocks::float_to_short::make(1,
-			-1 * (1 << (DAC_BIT_COUNT - 1)) /
-			AMPLITUDE_VOLTS * 16 / INTERP_BY_100_CORR);
-
-	auto head = blocks::head::make(
-			sizeof(short), samples_count);
+	const double scale = -1 * (1 << (DAC_BIT_COUNT - 1)) /
+			AMPLITUDE_VOLTS * 16 / INTERP_BY_100_CORR;
+	const double omega = 2.0 * M_PI * frequency / rate;
 
-	auto vector = blocks::vector_sink_s::make();
+	for (size_t i = 0; i < samples_count; i++) {
+		double value = (amplitude / 2.0 * sin(omega * i) + offset)
+			* scale;
 
-	top_block->connect(src, 0, f2s, 0);
-	top_block->connect(f2s, 0, head, 0);
-	top_block->connect(head, 0, vector, 0);
+		samples[i] = (short) std::max(-32768.0,
+				std::min(32767.0, round(value)));
+	}
 
-	top_block->run();
+	return samples;
+}
 
-	const std::vector<short> &samples = vector->data();
-	const short *data = samples.data();
+struct iio_buffer * NetworkAnalyzer::pushSinWave(
+		const struct iio_device *dev,
+		const std::vector<short>& samples,
+		unsigned long rate, bool set_rate)
+{
+	/* Create the IIO buffer */
+	struct iio_buffer *buf = iio_device_create_buffer(
+			dev, samples.size(), true);
+	if (!buf)
+		throw std::runtime_error("Unable to create buffer");
 
 	for (unsigned int i = 0; i < iio_device_get_channels_count(dev); i++) {
 		struct iio_channel *chn = iio_device_get_channel(dev, i);
 
 		if (iio_channel_is_enabled(chn)) {
-			iio_channel_write(chn, buf, data,
-					samples_count * sizeof(short));
+			iio_channel_write(chn, buf, samples.data(),
+					samples.size() * sizeof(short));
 		}
 	}
 
-	iio_device_attr_write_longlong(dev, "sampling_frequency", rate);
+	if (set_rate)
+		iio_device_attr_write_longlong(dev, "sampling_frequency", rate);
 
 	iio_buffer_push(buf);
 
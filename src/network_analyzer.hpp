@@ -22,10 +22,15 @@
 
 #include "apiObject.hpp"
 #include "iio_manager.hpp"
-#include "signal_sample.hpp"
 #include "tool.hpp"
 
 #include <QtConcurrentRun>
+#include <QVector>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 
 extern "C" {
 	struct iio_buffer;
@@ -68,25 +73,57 @@ namespace adiscope {
 		boost::shared_ptr<iio_manager> iio;
 
 		QFuture<void> thd;
-		bool stop;
+		std::atomic<bool> stop;
+
+		/* Signals the end of the acquisition of a sweep step, or that
+		 * the sweep was stopped */
+		std::mutex step_mutex;
+		std::condition_variable step_cond;
+
+		/* Acquisition buffers to let go by after retuning: the one
+		 * being captured while the settings changed and one that may
+		 * still be queued in the flowgraph */
+		static const unsigned int STALE_BUFFERS = 2;
+
+		/* Everything needed to run one step of the sweep, computed
+		 * ahead of time while the previous step is acquiring */
+		struct SweepStep {
+			double frequency;
+			unsigned long dac_rate;
+			unsigned long adc_rate;
+			size_t adc_buffer_size;
+			std::vector<short> dac_samples;
+		};
 
 		void run();
 
+		static SweepStep prepareStep(const struct iio_device *dac,
+				const struct iio_device *adc,
+				const QVector<unsigned long>& dac_rates,
+				const QVector<unsigned long>& adc_rates,
+				double frequency, double amplitude,
+				double offset);
+
 		static size_t get_sin_samples_count(
 				const struct iio_device *dev,
 				unsigned long rate,
 				double frequency);
 
-		static struct iio_buffer * generateSinWave(
-				const struct iio_device *dev,
+		static std::vector<short> generateSinWave(
 				double frequency,
 				double amplitude,
 				double offset,
 				unsigned long rate,
 				size_t samples_count);
 
+		static struct iio_buffer * pushSinWave(
+				const struct iio_device *dev,
+				const std::vector<short>& samples,
+				unsigned long rate, bool set_rate);
+
 		static unsigned long get_best_sample_rate(
 				const struct iio_device *dev,
+				const QVector<unsigned long>& rates,
 				double frequency);
 		void configHwForNetworkAnalyzing();
 
@@ -21,12 +21,15 @@
 #include <gnuradio/blocks/float_to_complex.h>
 #include <gnuradio/iio/math.h>
 
+#include <thread>
+
 /* Qt includes */
 #include <QtWidgets>
 #include <QDebug>
 #include <QVBoxLayout>
 #include <QtWidgets/QSpacerItem>
 #include <QSignalBlocker>
+#include <QPointer>
 
 /* Local includes */
 #include "adc_sample_conv.hpp"
@@ -42,6 +45,7 @@
 #include "buffer_previewer.hpp"
 #include "config.h"
 #include "customplotpositionbutton.h"
+#include "text_exporter.hpp"
 
 /* Generated UI */
 #include "ui_math_panel.h"
@@ -121,6 +125,7 @@ Oscilloscope::Oscilloscope(struct iio_context *ctx, Filter *filt,
 
 	this->qt_fft_block = adiscope::scope_sink_f::make(fft_size, adc->sampleRate(),
 			"Osc Frequency", nb_channels, (QObject *)&fft_plot);
+	this->qt_fft_block->set_float_frames(true);
 
 	this->qt_hist_block = adiscope::histogram_sink_f::make(1024, 100, 0, 20,
 			"Osc Histogram", nb_channels, (QObject *)&hist_plot);
@@ -549,6 +554,7 @@ Oscilloscope::Oscilloscope(struct iio_context *ctx, Filter *filt,
 Oscilloscope::~Oscilloscope()
 {
 	ui->pushButtonRunStop->setChecked(false);
+	stopRecording();
 
 	bool started = iio->started();
 	if (started)
@@ -672,58 +678,152 @@ void Oscilloscope::btnExport_clicked(){
 
 	if (export_dialog->exec()){
 		QString filter = export_dialog->selectedNameFilter();
-		QFile f(export_dialog->selectedFiles().at(0));
-		f.open(QIODevice::WriteOnly);
-		QTextStream outputStream(&f);
-		QString separator = "";
-		if (filter.contains(".txt")){
-			separator += "\t";
-		} else if (filter.contains(".csv")){
-			separator += ",";
-		}
+		char separator = filter.contains(".txt") ? '\t' : ',';
+		QString sep(separator);
+		QString header;
 
 		//write header data
-		outputStream << "Scopy Version:" << separator << QString(SCOPY_VERSION_GIT) << "\n";
+		header += "Scopy Version:" + sep + QString(SCOPY_VERSION_GIT) + "\n";
 		//TO DO: add more details for the device
-		outputStream << "Device:" << separator << "M2K" << "\n";
-		outputStream << "Generated on:" << separator << QDate::currentDate().toString("dddd MMMM dd/MM/yyyy") << "\n";
+		header += "Device:" + sep + "M2K" + "\n";
+		header += "Generated on:" + sep + QDate::currentDate().toString("dddd MMMM dd/MM/yyyy") + "\n";
 		//get nr of samples
-		int samples = plot.Curve(0)->data()->size();
-		outputStream << "Nr of samples:" << separator << QString::number(samples) << "\n";
+		unsigned long long samples = plot.rawDataLength(0);
+		header += "Nr of samples:" + sep + QString::number(samples) + "\n";
 
-		outputStream << "Sample" << separator;
-		outputStream << "Time(s)" << separator;
+		/* Snapshot the data, as the export runs in the background */
+		std::vector<double> time(plot.rawTimeData(0),
+				plot.rawTimeData(0) + samples);
+		std::vector<std::vector<double>> columns;
+
+		header += "Sample" + sep + "Time(s)";
 		int channels_number = nb_channels + nb_math_channels;
 		for (int i = 0; i < channels_number; ++i){
 			if (exportConfig[i]){
 				QString chNo = (i > 1) ? QString::number(i - 1) : QString::number(i + 1);
-				outputStream << ((i > 1) ? "Math" : "Channel") + chNo + "(V)"
-					<< ((i == channels_number - 1) ? "\n" : separator);
-			} else {
-				if (i == channels_number - 1){
-					outputStream << "\n";
-				}
+				header += sep + ((i > 1) ? "Math" : "Channel") + chNo + "(V)";
+				columns.push_back(std::vector<double>(
+					plot.rawData(i), plot.rawData(i) + samples));
 			}
 		}
-		for (int i = 0; i < samples; ++i){
-			outputStream << QString::number(i) << separator;
-			outputStream << plot.Curve(0)->data()->sample(i).x() << separator;
-			for (int j = 0; j < channels_number; ++j){
-				if (exportConfig[j]){
-					outputStream << plot.Curve(j)->data()->sample(i).y()
-					<< ((j == channels_number - 1) ? "\n" : separator);
-				} else {
-					if (j == channels_number - 1){
-						outputStream << "\n";
-					}
+		header += "\n";
+
+		/* The tool may be gone by the time the export is over */
+		QPointer<Oscilloscope> self(this);
+		exportSettings->enableExportButton(false);
+
+		TextExporter::exportWithProgress(this,
+			export_dialog->selectedFiles().at(0),
+			header.toUtf8(), samples,
+			[&](TextBuffer& buf, uint64_t first, uint64_t count) {
+			for (uint64_t i = first; i < first + count; ++i){
+				buf.appendUInt(i);
+				buf.append(separator);
+				buf.appendDouble(time[i]);
+				for (const auto& column : columns){
+					buf.append(separator);
+					buf.appendDouble(column[i]);
 				}
+				buf.append('\n');
 			}
-		}
-		f.close();
+		});
+
+		if (!self)
+			return;
+
+		exportSettings->enableExportButton(true);
 	}
 	pause(false);
 }
 
+bool Oscilloscope::startRecording(const QString& path)
+{
+	if (isRecording())
+		stopRecording();
+
+	CaptureInfo info;
+	info.sample_rate = adc->sampleRate();
+	info.filter_compensation = m2k_adc ?
+		m2k_adc->compTable(info.sample_rate) : 1.0;
+
+	for (unsigned int i = 0; i < nb_channels; i++) {
+		CaptureInfo::Channel chn;
+
+		if (m2k_adc) {
+			chn.gain_mode = m2k_adc->chnHwGainMode(i);
+			chn.hw_gain = m2k_adc->gainAt(m2k_adc->chnHwGainMode(i));
+			chn.correction_gain = m2k_adc->chnCorrectionGain(i);
+			chn.correction_offset = m2k_adc->chnCorrectionOffset(i);
+			chn.hw_offset = m2k_adc->chnHwOffset(i);
+		} else {
+			chn.gain_mode = 0;
+			chn.hw_gain = 1.0;
+			chn.correction_gain = 1.0;
+			chn.correction_offset = 0.0;
+			chn.hw_offset = 0.0;
+		}
+
+		info.channels.push_back(chn);
+	}
+
+	if (!capture_sink)
+		capture_sink = gnuradio::get_initial_sptr(
+			new raw_capture_sink(nb_channels));
+
+	if (!capture_sink->open(path, info))
+		return false;
+
+	/* Lock the flowgraph if we are already started */
+	bool started = iio->started();
+	if (started)
+		iio->lock();
+
+	for (unsigned int i = 0; i < nb_channels; i++)
+		capture_ids.push_back(iio->connect(capture_sink, i, i,
+			false, active_sample_count));
+
+	if (started)
+		iio->unlock();
+
+	/* The raw samples are tapped before any processing, so the recording
+	 * keeps going regardless of the state of the Run button */
+	for (auto id : capture_ids)
+		iio->start(id);
+
+	return true;
+}
+
+void Oscilloscope::stopRecording()
+{
+	if (!isRecording())
+		return;
+
+	for (auto id : capture_ids)
+		iio->stop(id);
+
+	bool started = iio->started();
+	if (started)
+		iio->lock();
+
+	for (auto id : capture_ids)
+		iio->disconnect(id);
+	capture_ids.clear();
+
+	if (started)
+		iio->unlock();
+
+	capture_sink->close();
+
+	qDebug() << "Recorded" << capture_sink->samplesWritten()
+		<< "samples per channel," << capture_sink->samplesDropped()
+		<< "dropped";
+}
+
+bool Oscilloscope::isRecording() const
+{
+	return !capture_ids.empty();
+}
+
 void Oscilloscope::create_math_panel()
 {
 	/* Math stuff */
@@ -1127,16 +1227,16 @@ void Oscilloscope::onFFT_view_toggled(bool visible)
 
 	if (visible) {
 		setFFT_params();
-		for (unsigned int i = 0; i < nb_channels; i++) {
-			auto fft = gnuradio::get_initial_sptr(
-					new fft_block(false, fft_size));
 
-			auto ctm = blocks::complex_to_mag_squared::make(1);
+		/* One block transforms all the channels in parallel */
+		auto fft = gnuradio::get_initial_sptr(
+				new fft_block(false, fft_size, nb_channels,
+					std::thread::hardware_concurrency()));
 
-			/** GNU Radio flow: iio(i) ->  fft -> ctm -> qt_fft_block */
-			fft_ids[i] = iio->connect(fft, i, 0, true);
-			iio->connect(fft, 0, ctm, 0);
-			iio->connect(ctm, 0, qt_fft_block, i);
+		for (unsigned int i = 0; i < nb_channels; i++) {
+			/** GNU Radio flow: iio(i) ->  fft(i) -> qt_fft_block */
+			fft_ids[i] = iio->connect(fft, i, i, true);
+			iio->connect(fft, i, qt_fft_block, i);
 
 			if (ui->pushButtonRunStop->isChecked())
 				iio->start(fft_ids[i]);
@@ -2809,6 +2909,21 @@ void Oscilloscope_API::setCurrentChannel(int chn_id)
 	name->setChecked(true);
 }
 
+bool Oscilloscope_API::startRecording(const QString& path)
+{
+	return osc->startRecording(path);
+}
+
+void Oscilloscope_API::stopRecording()
+{
+	osc->stopRecording();
+}
+
+bool Oscilloscope_API::isRecording() const
+{
+	return osc->isRecording();
+}
+
 QVariantList Oscilloscope_API::getChannels()
 {
 	QVariantList list;
@@ -2896,6 +3011,7 @@ void Channel_API::setLineThickness(double val)
 	double Channel_API::measured_ ## m () const\
 	{\
 		int index = osc->channels_api.indexOf(const_cast<Channel_API*>(this));\
+		osc->plot.flushMeasurements();\
 		auto measData = osc->plot.measurement(Measure::t, index);\
 		return measData->value();\
 	}
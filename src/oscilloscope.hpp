@@ -25,7 +25,6 @@
 /* GNU Radio includes */
 #include <gnuradio/blocks/short_to_float.h>
 #include <gnuradio/iio/device_source.h>
-#include <gnuradio/blocks/complex_to_mag_squared.h>
 
 /* Qt includes */
 #include <QPair>
@@ -43,6 +42,7 @@
 #include "filter.hpp"
 #include "fft_block.hpp"
 #include "scope_sink_f.h"
+#include "raw_capture_sink.hpp"
 #include "xy_sink_c.h"
 #include "histogram_sink_f.h"
 #include "ConstellationDisplayPlot.h"
@@ -93,6 +93,10 @@ namespace adiscope {
 				ToolLauncher *parent = 0);
 		~Oscilloscope();
 
+		bool startRecording(const QString& path);
+		void stopRecording();
+		bool isRecording() const;
+
 	Q_SIGNALS:
 		void triggerALevelChanged(double);
 		void triggerBLevelChanged(double);
@@ -217,6 +221,9 @@ namespace adiscope {
 		iio_manager::port_id *hist_ids;
 		iio_manager::port_id *xy_ids;
 
+		raw_capture_sink::sptr capture_sink;
+		std::vector<iio_manager::port_id> capture_ids;
+
 		ScaleSpinButton *timeBase;
 		PositionSpinButton *timePosition;
 		ScaleSpinButton *voltsPerDiv;
@@ -442,6 +449,10 @@ namespace adiscope {
 		int getCurrentChannel() const;
 		void setCurrentChannel(int chn_id);
 
+		Q_INVOKABLE bool startRecording(const QString& path);
+		Q_INVOKABLE void stopRecording();
+		Q_INVOKABLE bool isRecording() const;
+
 	private:
 		Oscilloscope *osc;
 	};
@@ -319,6 +319,8 @@ CapturePlot::CapturePlot(QWidget *parent,
 	/* Apply measurements for every new batch of data */
 	connect(this, SIGNAL(newData()),
 		SLOT(onNewDataReceived()));
+	connect(&d_measureEngine, SIGNAL(measurementsReady(quint64)),
+		SLOT(onMeasurementsReady()));
 
 	/* Add offset widgets for each new channel */
 	connect(this, SIGNAL(channelAdded(int)),
@@ -655,7 +657,7 @@ void CapturePlot::onChannelAdded(int chnIdx)
 
 	/* Add Measure ojbect that handles all channel measurements */
 	Measure *measure = new Measure(chnIdx, d_ydata[chnIdx],
-		Curve(chnIdx)->data()->size());
+		rawDataLength(chnIdx));
 	measure->setAdcBitCount(12);
 	d_measureObjs.push_back(measure);
 }
@@ -664,6 +666,8 @@ void CapturePlot::cleanUpJustBeforeChannelRemoval(int chnIdx)
 {
 	Measure *measure = measureOfChannel(chnIdx);
 	if (measure) {
+		d_measureEngine.invalidate();
+
 		int pos = d_measureObjs.indexOf(measure);
 		for (int i = pos + 1; i < d_measureObjs.size(); i++) {
 			d_measureObjs[i]->setChannel(
@@ -694,15 +698,39 @@ void CapturePlot::removeOffsetWidgets(int chnIdx)
 	delete(d_offsetHandles.takeAt(chnIdx));
 }
 
-void CapturePlot::measure()
+QList<Measure *> CapturePlot::activeMeasures()
 {
+	QList<Measure *> measures;
+
 	for (int i = 0; i < d_measureObjs.size(); i++) {
 		Measure *measure = d_measureObjs[i];
 		if (measure->activeMeasurementsCount() > 0) {
+			int chn = measure->channel();
+			measure->setDataSource(d_ydata[chn],
+				rawDataLength(chn));
 			measure->setSampleRate(this->sampleRate());
-			measure->measure();
+			measures.push_back(measure);
 		}
 	}
+
+	return measures;
+}
+
+void CapturePlot::measure()
+{
+	QList<Measure *> measures = activeMeasures();
+
+	// Whatever the engine is still working on is older than this
+	d_measureEngine.invalidate();
+
+	for (int i = 0; i < measures.size(); i++)
+		measures[i]->measure();
+}
+
+void CapturePlot::flushMeasurements()
+{
+	if (d_measureEngine.busy())
+		measure();
 }
 
 int CapturePlot::activeMeasurementsCount(int chnIdx)
@@ -721,17 +749,13 @@ void CapturePlot::onNewDataReceived()
 	if (!d_measurementsEnabled)
 		return;
 
-	for (int i = 0; i < d_measureObjs.size(); i++) {
-		Measure *measure = d_measureObjs[i];
-		if (measure->activeMeasurementsCount() > 0) {
-			int chn = measure->channel();
-			measure->setDataSource(d_ydata[chn],
-				Curve(chn)->data()->size());
-			measure->setSampleRate(this->sampleRate());
-			measure->measure();
-		}
-	}
+	// The data gets snapshotted, results come back through
+	// onMeasurementsReady()
+	d_measureEngine.submit(activeMeasures());
+}
 
+void CapturePlot::onMeasurementsReady()
+{
 	Q_EMIT measurementsAvailable();
 }
 
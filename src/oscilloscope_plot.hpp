@@ -26,6 +26,7 @@
 #include "plot_line_handle.h"
 #include "cursor_readouts.h"
 #include "measure.h"
+#include "measure_engine.hpp"
 #include "customplotpositionbutton.h"
 
 class QLabel;
@@ -93,7 +94,17 @@ namespace adiscope {
 		void removeOffsetWidgets(int chnIdx);
 		void removeLeftVertAxis(unsigned int axis);
 
+		/*
+		 * Measures the current data of the channels right away. The
+		 * measurements of new data, on the other hand, are computed
+		 * off the GUI thread and signaled by measurementsAvailable(),
+		 * so until then the values read are those of an older frame.
+		 */
 		void measure();
+
+		/* Same as measure(), but only if newer data is being measured */
+		void flushMeasurements();
+
 		int activeMeasurementsCount(int chnIdx);
 		QList<std::shared_ptr<MeasurementData>> measurements(int chnIdx);
 		std::shared_ptr<MeasurementData> measurement(int id, int chnIdx);
@@ -128,11 +139,13 @@ namespace adiscope {
 
 	private:
 		Measure* measureOfChannel(int chnIdx) const;
+		QList<Measure *> activeMeasures();
 		void updateBufferSizeSampleRateLabel(int nsamples, double sr);
 
 	private Q_SLOTS:
 		void onChannelAdded(int);
 		void onNewDataReceived();
+		void onMeasurementsReady();
 
 
 		void onHbar1PixelPosChanged(int);
@@ -158,6 +171,7 @@ namespace adiscope {
 		bool d_vertCursorsEnabled;
 		bool d_horizCursorsEnabled;
 		bool d_measurementsEnabled;
+		MeasureEngine d_measureEngine;
 
 		int d_selected_channel;
 
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "peak_finder.hpp"
+
+#include <algorithm>
+
+using namespace adiscope;
+
+static bool higher(const PeakFinder::Peak& a, const PeakFinder::Peak& b)
+{
+	return a.value > b.value;
+}
+
+PeakFinder::PeakFinder(unsigned int max_peaks) :
+	d_max_peaks(max_peaks)
+{
+	d_peaks.reserve(max_peaks);
+}
+
+unsigned int PeakFinder::maxPeaks() const
+{
+	return d_max_peaks;
+}
+
+void PeakFinder::setMaxPeaks(unsigned int max_peaks)
+{
+	d_max_peaks = max_peaks;
+	d_peaks.reserve(max_peaks);
+}
+
+void PeakFinder::push(const float *data, size_t size, size_t bin)
+{
+	Peak peak;
+
+	peak.bin = bin;
+	peak.position = bin;
+	peak.value = data[bin];
+
+	if (bin > 0 && bin + 1 < size) {
+		double a = data[bin - 1];
+		double b = data[bin];
+		double c = data[bin + 1];
+		double den = a - 2.0 * b + c;
+
+		if (den < 0.0) {
+			double delta = 0.5 * (a - c) / den;
+
+			peak.position += delta;
+			peak.value = b - 0.25 * (a - c) * delta;
+		}
+	}
+
+	/* The heap keeps the lowest of the best peaks at its front */
+	if (d_peaks.size() < d_max_peaks) {
+		d_peaks.push_back(peak);
+		std::push_heap(d_peaks.begin(), d_peaks.end(), higher);
+	} else if (peak.value > d_peaks.front().value) {
+		std::pop_heap(d_peaks.begin(), d_peaks.end(), higher);
+		d_peaks.back() = peak;
+		std::push_heap(d_peaks.begin(), d_peaks.end(), higher);
+	}
+}
+
+const std::vector<PeakFinder::Peak>& PeakFinder::find(const float *data,
+		size_t size)
+{
+	d_peaks.clear();
+
+	if (!d_max_peaks || !size)
+		return d_peaks;
+
+	if (size == 1) {
+		push(data, size, 0);
+		return d_peaks;
+	}
+
+	if (data[0] >= data[1])
+		push(data, size, 0);
+
+	/* The first point of a plateau counts as its peak */
+	for (size_t i = 1; i + 1 < size; i++)
+		if (data[i] > data[i - 1] && data[i] >= data[i + 1])
+			push(data, size, i);
+
+	if (data[size - 1] > data[size - 2])
+		push(data, size, size - 1);
+
+	std::sort_heap(d_peaks.begin(), d_peaks.end(), higher);
+
+	return d_peaks;
+}
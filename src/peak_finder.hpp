@@ -0,0 +1,64 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef PEAK_FINDER_HPP
+#define PEAK_FINDER_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace adiscope {
+
+	/*
+	 * Finds the highest local maxima of a trace in a single pass. The
+	 * best candidates are kept in a bounded min-heap, so the cost is
+	 * O(n + m log k) for n points, m local maxima and k peaks, instead
+	 * of O(n k).
+	 *
+	 * The position and level of each peak are refined by fitting a
+	 * parabola through the peak and its two neighbours. On a trace in
+	 * dB this is the same as a Gaussian fit of the linear magnitude,
+	 * which is close to the main lobe of the usual FFT windows.
+	 */
+	class PeakFinder
+	{
+	public:
+		struct Peak {
+			size_t bin;
+			double position;	/* Fractional bin */
+			double value;
+		};
+
+		explicit PeakFinder(unsigned int max_peaks = 0);
+
+		unsigned int maxPeaks() const;
+		void setMaxPeaks(unsigned int max_peaks);
+
+		/* Returns the peaks sorted by decreasing value */
+		const std::vector<Peak>& find(const float *data, size_t size);
+
+	private:
+		void push(const float *data, size_t size, size_t bin);
+
+		unsigned int d_max_peaks;
+		std::vector<Peak> d_peaks;
+	};
+}
+
+#endif /* PEAK_FINDER_HPP */
@@ -31,9 +31,10 @@ namespace pv {
 namespace data {
 namespace decode {
 
-Annotation::Annotation(const srd_proto_data *const pdata) :
-	start_sample_(pdata->start_sample),
-	end_sample_(pdata->end_sample)
+Annotation::Annotation(const srd_proto_data *const pdata,
+	uint64_t sample_offset) :
+	start_sample_(pdata->start_sample + sample_offset),
+	end_sample_(pdata->end_sample + sample_offset)
 {
 	assert(pdata);
 	const srd_proto_data_annotation *const pda =
@@ -49,6 +50,15 @@ Annotation::Annotation(const srd_proto_data *const pdata) :
 	}
 }
 
+Annotation::Annotation(uint64_t start_sample, uint64_t end_sample,
+	int format, const std::vector<QString> &annotations) :
+	start_sample_(start_sample),
+	end_sample_(end_sample),
+	format_(format),
+	annotations_(annotations)
+{
+}
+
 uint64_t Annotation::start_sample() const
 {
 	return start_sample_;
@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include <QString>
 
 struct srd_proto_data;
@@ -34,7 +36,10 @@ namespace decode {
 class Annotation
 {
 public:
-	Annotation(const srd_proto_data *const pdata);
+	Annotation(const srd_proto_data *const pdata,
+		uint64_t sample_offset = 0);
+	Annotation(uint64_t start_sample, uint64_t end_sample, int format,
+		const std::vector<QString> &annotations);
 
 	uint64_t start_sample() const;
 	uint64_t end_sample() const;
@@ -38,7 +38,8 @@ namespace decode {
 
 Decoder::Decoder(const srd_decoder *const dec) :
 	decoder_(dec),
-	shown_(true)
+	shown_(true),
+	native_(true)
 {
 }
 
@@ -63,6 +64,16 @@ void Decoder::show(bool show)
 	shown_ = show;
 }
 
+bool Decoder::native() const
+{
+	return native_;
+}
+
+void Decoder::set_native(bool native)
+{
+	native_ = native;
+}
+
 const map<const srd_channel*, shared_ptr<view::LogicSignal> >&
 Decoder::channels() const
 {
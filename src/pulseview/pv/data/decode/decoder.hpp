@@ -56,6 +56,13 @@ public:
 	bool shown() const;
 	void show(bool show = true);
 
+	/**
+	 * Whether the built-in native implementation of the decoder is
+	 * used, when there is one, instead of the libsigrokdecode one.
+	 */
+	bool native() const;
+	void set_native(bool native);
+
 	const std::map<const srd_channel*,
 		std::shared_ptr<view::LogicSignal> >& channels() const;
 	void set_channels(std::map<const srd_channel*,
@@ -76,6 +83,7 @@ private:
 	const srd_decoder *const decoder_;
 
 	bool shown_;
+	bool native_;
 
 	std::map<const srd_channel*, std::shared_ptr<pv::view::LogicSignal> >
 		channels_;
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <libsigrokcxx/libsigrokcxx.hpp>
+#include <libsigrokdecode/libsigrokdecode.h>
+
+#include "nativedecoder.hpp"
+#include "nativei2c.hpp"
+#include "nativespi.hpp"
+#include "nativeuart.hpp"
+
+#include "decoder.hpp"
+
+#include "../logicsegment.hpp"
+#include "../../view/logicsignal.hpp"
+
+using std::min;
+using std::string;
+using std::unique_ptr;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+NativeDecoder::NativeDecoder(int64_t start_sample) :
+	start_sample_(start_sample)
+{
+}
+
+NativeDecoder::~NativeDecoder()
+{
+}
+
+bool NativeDecoder::available(const srd_decoder *dec)
+{
+	assert(dec);
+
+	return strcmp(dec->id, "uart") == 0 || strcmp(dec->id, "spi") == 0 ||
+		strcmp(dec->id, "i2c") == 0;
+}
+
+unique_ptr<NativeDecoder> NativeDecoder::create(const Decoder &decoder,
+	double samplerate, int64_t start_sample)
+{
+	const char *const id = decoder.decoder()->id;
+	unique_ptr<NativeDecoder> native;
+
+	if (strcmp(id, "uart") == 0 && (channel_bit(decoder, "rx") >= 0 ||
+			channel_bit(decoder, "tx") >= 0))
+		native.reset(new NativeUart(decoder, samplerate,
+			start_sample));
+	else if (strcmp(id, "spi") == 0 && NativeSpi::supported(decoder) &&
+			channel_bit(decoder, "clk") >= 0 &&
+			(channel_bit(decoder, "miso") >= 0 ||
+			 channel_bit(decoder, "mosi") >= 0))
+		native.reset(new NativeSpi(decoder, start_sample));
+	else if (strcmp(id, "i2c") == 0 && channel_bit(decoder, "scl") >= 0 &&
+			channel_bit(decoder, "sda") >= 0)
+		native.reset(new NativeI2C(decoder, start_sample));
+
+	return native;
+}
+
+int NativeDecoder::channel_bit(const Decoder &decoder, const char *id)
+{
+	for (const auto& channel : decoder.channels())
+		if (strcmp(channel.first->id, id) == 0 && channel.second)
+			return channel.second->channel()->index();
+
+	return -1;
+}
+
+static GVariant* get_option(const Decoder &decoder, const char *id)
+{
+	const auto iter = decoder.options().find(id);
+	if (iter != decoder.options().end())
+		return (*iter).second;
+
+	for (GSList *l = decoder.decoder()->options; l; l = l->next) {
+		const srd_decoder_option *const opt =
+			(srd_decoder_option*)l->data;
+		if (strcmp(opt->id, id) == 0)
+			return opt->def;
+	}
+
+	return nullptr;
+}
+
+int64_t NativeDecoder::option_int(const Decoder &decoder, const char *id)
+{
+	GVariant *const value = get_option(decoder, id);
+
+	if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_INT64))
+		return g_variant_get_int64(value);
+	if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_DOUBLE))
+		return (int64_t)g_variant_get_double(value);
+
+	return 0;
+}
+
+double NativeDecoder::option_double(const Decoder &decoder, const char *id)
+{
+	GVariant *const value = get_option(decoder, id);
+
+	if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_DOUBLE))
+		return g_variant_get_double(value);
+	if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_INT64))
+		return g_variant_get_int64(value);
+
+	return 0.0;
+}
+
+string NativeDecoder::option_string(const Decoder &decoder, const char *id)
+{
+	GVariant *const value = get_option(decoder, id);
+
+	if (value && g_variant_is_of_type(value, G_VARIANT_TYPE_STRING))
+		return g_variant_get_string(value, nullptr);
+
+	return string();
+}
+
+uint64_t NativeDecoder::sample(const LogicSegment &segment, int64_t index)
+{
+	// get_samples() holds the segment lock, so this is safe while the
+	// capture is still appending data
+	uint8_t data[8] = {};
+	uint64_t value = 0;
+
+	assert(segment.unit_size() <= sizeof(data));
+	index %= segment.get_sample_count();
+	segment.get_samples(data, index, index + 1);
+
+	for (int i = sizeof(data) - 1; i >= 0; i--)
+		value = (value << 8) | data[i];
+
+	return value;
+}
+
+int64_t NativeDecoder::next_edge(const LogicSegment &segment, int64_t start,
+	int64_t end, uint64_t mask)
+{
+	const int64_t count = segment.get_sample_count();
+
+	while (start < end) {
+		const int64_t index = start % count;
+
+		// The first sample of the segment follows the last one
+		if (index == 0) {
+			if (start > 0 && ((sample(segment, start) ^
+					sample(segment, start - 1)) & mask))
+				return start;
+			start++;
+			continue;
+		}
+
+		const int64_t length = min(end - start, count - index);
+		const int64_t edge = segment.find_next_edge(index,
+			index + length, mask);
+		if (edge < index + length)
+			return start + edge - index;
+
+		start += length;
+	}
+
+	return end;
+}
+
+} // namespace decode
+} // namespace data
+} // namespace pv
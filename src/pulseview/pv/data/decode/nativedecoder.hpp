@@ -0,0 +1,119 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_NATIVEDECODER_HPP
+#define PULSEVIEW_PV_DATA_DECODE_NATIVEDECODER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "annotation.hpp"
+
+struct srd_decoder;
+
+namespace pv {
+namespace data {
+
+class LogicSegment;
+
+namespace decode {
+
+class Decoder;
+
+/**
+ * Built-in C++ implementation of a libsigrokdecode protocol decoder.
+ *
+ * It emits the same annotation classes and texts as the Python decoder
+ * with the same id, so its annotations land in the same rows. It reads
+ * the LogicSegment directly and uses the segment's transition mip map
+ * to jump from edge to edge, so idle stretches cost nothing.
+ *
+ * Decoding can be resumed: decode() may be called again with a later
+ * end sample as more data comes in. Sample numbers are counted from the
+ * beginning of the capture; once the segment is used as a ring buffer
+ * they are mapped onto it, so the decoder must not fall behind by more
+ * than the length of the segment.
+ */
+class NativeDecoder
+{
+public:
+	virtual ~NativeDecoder();
+
+	/**
+	 * Returns true if there is a native implementation of the given
+	 * libsigrokdecode decoder.
+	 */
+	static bool available(const srd_decoder *dec);
+
+	/**
+	 * Creates the native implementation of a decoder, set up with the
+	 * decoder's channels and options, that starts decoding at
+	 * start_sample. Returns nullptr if there is none, or if the
+	 * channels it needs are not assigned.
+	 */
+	static std::unique_ptr<NativeDecoder> create(const Decoder &decoder,
+		double samplerate, int64_t start_sample = 0);
+
+	/**
+	 * Decodes the samples up to end_sample and appends the resulting
+	 * annotations. The annotations of each row are appended in order
+	 * of their start sample.
+	 */
+	virtual void decode(const LogicSegment &segment, int64_t end_sample,
+		std::vector<Annotation> &annotations) = 0;
+
+protected:
+	explicit NativeDecoder(int64_t start_sample);
+
+	/**
+	 * Returns the bit of the given channel in the samples, or -1 if
+	 * it has not been assigned.
+	 */
+	static int channel_bit(const Decoder &decoder, const char *id);
+
+	/**
+	 * Get the value of an option, or its default value if it has not
+	 * been set.
+	 */
+	static int64_t option_int(const Decoder &decoder, const char *id);
+	static double option_double(const Decoder &decoder, const char *id);
+	static std::string option_string(const Decoder &decoder,
+		const char *id);
+
+	static uint64_t sample(const LogicSegment &segment, int64_t index);
+
+	/**
+	 * Finds the next transition of any of the given signals, like
+	 * LogicSegment::find_next_edge(), across the end of the segment
+	 * when it is used as a ring buffer.
+	 */
+	static int64_t next_edge(const LogicSegment &segment, int64_t start,
+		int64_t end, uint64_t mask);
+
+protected:
+	const int64_t start_sample_;
+};
+
+} // namespace decode
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_NATIVEDECODER_HPP
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "nativei2c.hpp"
+
+#include "../logicsegment.hpp"
+
+using std::vector;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+NativeI2C::NativeI2C(const Decoder &decoder, int64_t start_sample) :
+	NativeDecoder(start_sample),
+	scl_bit_(channel_bit(decoder, "scl")),
+	sda_bit_(channel_bit(decoder, "sda")),
+	mask_((1ULL << scl_bit_) | (1ULL << sda_bit_)),
+	shifted_(option_string(decoder, "address_format") != "unshifted"),
+	state_(FindStart),
+	next_(start_sample),
+	old_scl_(1),
+	old_sda_(1),
+	repeat_start_(false),
+	write_(false),
+	bitcount_(0),
+	databyte_(0),
+	bitwidth_(0)
+{
+}
+
+void NativeI2C::decode(const LogicSegment &segment, int64_t end_sample,
+	vector<Annotation> &annotations)
+{
+	// The first sample is always looked at, then only the changes
+	if (next_ == start_sample_ && end_sample > next_) {
+		handle_sample(next_, sample(segment, next_), annotations);
+		next_++;
+	}
+
+	while (next_ < end_sample) {
+		const int64_t n = next_edge(segment, next_, end_sample, mask_);
+		if (n >= end_sample) {
+			next_ = end_sample;
+			break;
+		}
+
+		handle_sample(n, sample(segment, n), annotations);
+		next_ = n + 1;
+	}
+}
+
+void NativeI2C::handle_sample(int64_t samplenum, uint64_t pins,
+	vector<Annotation> &annotations)
+{
+	const unsigned int scl = (pins >> scl_bit_) & 1;
+	const unsigned int sda = (pins >> sda_bit_) & 1;
+
+	// START: SDA falls while SCL is high; STOP: SDA rises while SCL is
+	// high; data bits are sampled on the rising edge of SCL
+	const bool start = old_sda_ && !sda && scl;
+	const bool stop = !old_sda_ && sda && scl;
+	const bool data_bit = !old_scl_ && scl;
+
+	switch (state_) {
+	case FindStart:
+		if (start)
+			found_start(samplenum, annotations);
+		break;
+	case FindAddress:
+		if (data_bit)
+			found_address_or_data(samplenum, sda, annotations);
+		break;
+	case FindData:
+		if (data_bit)
+			found_address_or_data(samplenum, sda, annotations);
+		else if (start)
+			found_start(samplenum, annotations);
+		else if (stop)
+			found_stop(samplenum, annotations);
+		break;
+	case FindAck:
+		if (data_bit)
+			found_ack(samplenum, sda, annotations);
+		break;
+	}
+
+	old_scl_ = scl;
+	old_sda_ = sda;
+}
+
+void NativeI2C::found_start(int64_t samplenum, vector<Annotation> &annotations)
+{
+	if (repeat_start_)
+		annotations.push_back(Annotation(samplenum, samplenum, 1,
+			{"Start repeat", "Sr"}));
+	else
+		annotations.push_back(Annotation(samplenum, samplenum, 0,
+			{"Start", "S"}));
+
+	state_ = FindAddress;
+	bitcount_ = databyte_ = 0;
+	repeat_start_ = true;
+}
+
+void NativeI2C::found_address_or_data(int64_t samplenum, unsigned int sda,
+	vector<Annotation> &annotations)
+{
+	// Address and data are transmitted MSB-first
+	databyte_ = (databyte_ << 1) | sda;
+	bit_samples_[bitcount_] = samplenum;
+	bits_[bitcount_] = sda;
+
+	if (bitcount_ < 7) {
+		bitcount_++;
+		return;
+	}
+
+	bitwidth_ = samplenum - bit_samples_[6];
+
+	unsigned int d = databyte_;
+	int format;
+	const char *name, *abbrev;
+
+	if (state_ == FindAddress) {
+		// The READ/WRITE bit is only in address bytes
+		write_ = !(databyte_ & 1);
+		if (shifted_)
+			d >>= 1;
+	}
+
+	if (state_ == FindAddress && write_) {
+		format = 7, name = "Address write", abbrev = "AW";
+	} else if (state_ == FindAddress) {
+		format = 6, name = "Address read", abbrev = "AR";
+	} else if (write_) {
+		format = 9, name = "Data write", abbrev = "DW";
+	} else {
+		format = 8, name = "Data read", abbrev = "DR";
+	}
+
+	for (int i = 0; i < 8; i++)
+		annotations.push_back(Annotation(bit_samples_[i],
+			i < 7 ? bit_samples_[i + 1] : samplenum + bitwidth_,
+			5, {QString::number(bits_[i])}));
+
+	const QString hex = QString("%1").arg(d, 2, 16, QChar('0')).toUpper();
+	const vector<QString> texts = {
+		QString("%1: %2").arg(name, hex),
+		QString("%1: %2").arg(abbrev, hex),
+		hex,
+	};
+
+	if (state_ == FindAddress) {
+		// The address ends where its READ/WRITE bit begins
+		annotations.push_back(Annotation(bit_samples_[0], samplenum,
+			format, texts));
+		if (write_)
+			annotations.push_back(Annotation(samplenum,
+				samplenum + bitwidth_, format,
+				{"Write", "Wr", "W"}));
+		else
+			annotations.push_back(Annotation(samplenum,
+				samplenum + bitwidth_, format,
+				{"Read", "Rd", "R"}));
+	} else {
+		annotations.push_back(Annotation(bit_samples_[0],
+			samplenum + bitwidth_, format, texts));
+	}
+
+	bitcount_ = databyte_ = 0;
+	state_ = FindAck;
+}
+
+void NativeI2C::found_ack(int64_t samplenum, unsigned int sda,
+	vector<Annotation> &annotations)
+{
+	if (sda)
+		annotations.push_back(Annotation(samplenum,
+			samplenum + bitwidth_, 4, {"NACK", "N"}));
+	else
+		annotations.push_back(Annotation(samplenum,
+			samplenum + bitwidth_, 3, {"ACK", "A"}));
+
+	// Either another data byte or a STOP condition follows
+	state_ = FindData;
+}
+
+void NativeI2C::found_stop(int64_t samplenum, vector<Annotation> &annotations)
+{
+	annotations.push_back(Annotation(samplenum, samplenum, 2, {"Stop", "P"}));
+
+	state_ = FindStart;
+	repeat_start_ = false;
+}
+
+} // namespace decode
+} // namespace data
+} // namespace pv
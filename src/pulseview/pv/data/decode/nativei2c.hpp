@@ -0,0 +1,86 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_NATIVEI2C_HPP
+#define PULSEVIEW_PV_DATA_DECODE_NATIVEI2C_HPP
+
+#include "nativedecoder.hpp"
+
+namespace pv {
+namespace data {
+namespace decode {
+
+/**
+ * Native version of the "i2c" decoder. Only the samples where SCL or
+ * SDA changes are looked at.
+ */
+class NativeI2C : public NativeDecoder
+{
+private:
+	enum State {
+		FindStart,
+		FindAddress,
+		FindData,
+		FindAck,
+	};
+
+public:
+	NativeI2C(const Decoder &decoder, int64_t start_sample);
+
+	void decode(const LogicSegment &segment, int64_t end_sample,
+		std::vector<Annotation> &annotations);
+
+private:
+	void handle_sample(int64_t samplenum, uint64_t pins,
+		std::vector<Annotation> &annotations);
+	void found_start(int64_t samplenum,
+		std::vector<Annotation> &annotations);
+	void found_address_or_data(int64_t samplenum, unsigned int sda,
+		std::vector<Annotation> &annotations);
+	void found_ack(int64_t samplenum, unsigned int sda,
+		std::vector<Annotation> &annotations);
+	void found_stop(int64_t samplenum,
+		std::vector<Annotation> &annotations);
+
+private:
+	int scl_bit_;
+	int sda_bit_;
+	uint64_t mask_;
+	bool shifted_;
+
+	State state_;
+	int64_t next_;
+	unsigned int old_scl_;
+	unsigned int old_sda_;
+	bool repeat_start_;
+	bool write_;
+
+	unsigned int bitcount_;
+	unsigned int databyte_;
+	int64_t bit_samples_[8];
+	unsigned int bits_[8];
+	int64_t bitwidth_;
+};
+
+} // namespace decode
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_NATIVEI2C_HPP
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include "nativespi.hpp"
+
+#include "../logicsegment.hpp"
+
+using std::vector;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+NativeSpi::NativeSpi(const Decoder &decoder, int64_t start_sample) :
+	NativeDecoder(start_sample),
+	clk_bit_(channel_bit(decoder, "clk")),
+	miso_bit_(channel_bit(decoder, "miso")),
+	mosi_bit_(channel_bit(decoder, "mosi")),
+	cs_bit_(channel_bit(decoder, "cs")),
+	mask_(0),
+	cs_active_low_(option_string(decoder, "cs_polarity") != "active-high"),
+	sample_on_rising_(option_int(decoder, "cpol") ==
+		option_int(decoder, "cpha")),
+	msb_first_(option_string(decoder, "bitorder") != "lsb-first"),
+	wordsize_(option_int(decoder, "wordsize")),
+	next_(start_sample),
+	old_clk_(-1),
+	old_cs_(-1)
+{
+	for (int bit : { clk_bit_, miso_bit_, mosi_bit_, cs_bit_ })
+		if (bit >= 0)
+			mask_ |= 1ULL << bit;
+
+	reset_word();
+}
+
+bool NativeSpi::supported(const Decoder &decoder)
+{
+	const int64_t wordsize = option_int(decoder, "wordsize");
+	return wordsize >= 1 && wordsize <= 64;
+}
+
+void NativeSpi::decode(const LogicSegment &segment, int64_t end_sample,
+	vector<Annotation> &annotations)
+{
+	// The first sample is always looked at, then only the changes
+	if (next_ == start_sample_ && end_sample > next_) {
+		handle_sample(next_, sample(segment, next_), annotations);
+		next_++;
+	}
+
+	while (next_ < end_sample) {
+		const int64_t n = next_edge(segment, next_, end_sample, mask_);
+		if (n >= end_sample) {
+			next_ = end_sample;
+			break;
+		}
+
+		handle_sample(n, sample(segment, n), annotations);
+		next_ = n + 1;
+	}
+}
+
+void NativeSpi::handle_sample(int64_t samplenum, uint64_t pins,
+	vector<Annotation> &annotations)
+{
+	if (cs_bit_ >= 0) {
+		const int cs = (pins >> cs_bit_) & 1;
+
+		// Any change of CS# drops the word being received
+		if (cs != old_cs_) {
+			old_cs_ = cs;
+			reset_word();
+		}
+
+		if (cs != (cs_active_low_ ? 0 : 1))
+			return;
+	}
+
+	const int clk = (pins >> clk_bit_) & 1;
+	if (clk == old_clk_)
+		return;
+
+	old_clk_ = clk;
+
+	if (clk == (sample_on_rising_ ? 1 : 0))
+		handle_bit(samplenum, pins, annotations);
+}
+
+void NativeSpi::handle_bit(int64_t samplenum, uint64_t pins,
+	vector<Annotation> &annotations)
+{
+	const unsigned int shift = msb_first_ ?
+		wordsize_ - 1 - bitcount_ : bitcount_;
+
+	if (miso_bit_ >= 0) {
+		const unsigned int miso = (pins >> miso_bit_) & 1;
+		miso_data_ |= (uint64_t)miso << shift;
+		miso_bits_.push_back(miso);
+	}
+
+	if (mosi_bit_ >= 0) {
+		const unsigned int mosi = (pins >> mosi_bit_) & 1;
+		mosi_data_ |= (uint64_t)mosi << shift;
+		mosi_bits_.push_back(mosi);
+	}
+
+	bit_samples_.push_back(samplenum);
+
+	if (++bitcount_ != wordsize_)
+		return;
+
+	put_word(annotations);
+	reset_word();
+}
+
+void NativeSpi::put_word(vector<Annotation> &annotations)
+{
+	const int64_t last = bit_samples_.back();
+
+	// A bit ends where the next one starts; the length of the last one
+	// is guessed from the one before it
+	const int64_t end = bit_samples_.size() > 1 ?
+		2 * last - bit_samples_[bit_samples_.size() - 2] : last;
+
+	const auto put_bits = [&](const vector<unsigned int> &bits,
+			int format) {
+		for (size_t i = 0; i < bits.size(); i++)
+			annotations.push_back(Annotation(bit_samples_[i],
+				i + 1 < bits.size() ? bit_samples_[i + 1] : end,
+				format, {QString::number(bits[i])}));
+	};
+
+	const auto put_data = [&](uint64_t data, int format) {
+		annotations.push_back(Annotation(bit_samples_.front(), end,
+			format, {QString("%1").arg((qulonglong)data, 2, 16,
+				QChar('0')).toUpper()}));
+	};
+
+	if (miso_bit_ >= 0) {
+		put_bits(miso_bits_, 2);
+		put_data(miso_data_, 0);
+	}
+
+	if (mosi_bit_ >= 0) {
+		put_bits(mosi_bits_, 3);
+		put_data(mosi_data_, 1);
+	}
+}
+
+void NativeSpi::reset_word()
+{
+	bitcount_ = 0;
+	miso_data_ = 0;
+	mosi_data_ = 0;
+	bit_samples_.clear();
+	miso_bits_.clear();
+	mosi_bits_.clear();
+}
+
+} // namespace decode
+} // namespace data
+} // namespace pv
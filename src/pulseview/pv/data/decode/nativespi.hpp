@@ -0,0 +1,81 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_NATIVESPI_HPP
+#define PULSEVIEW_PV_DATA_DECODE_NATIVESPI_HPP
+
+#include "nativedecoder.hpp"
+
+namespace pv {
+namespace data {
+namespace decode {
+
+/**
+ * Native version of the "spi" decoder. Only the samples where one of
+ * the SPI lines changes are looked at.
+ */
+class NativeSpi : public NativeDecoder
+{
+public:
+	NativeSpi(const Decoder &decoder, int64_t start_sample);
+
+	/** Returns true if the decoder's word size can be handled */
+	static bool supported(const Decoder &decoder);
+
+	void decode(const LogicSegment &segment, int64_t end_sample,
+		std::vector<Annotation> &annotations);
+
+private:
+	void handle_sample(int64_t samplenum, uint64_t pins,
+		std::vector<Annotation> &annotations);
+	void handle_bit(int64_t samplenum, uint64_t pins,
+		std::vector<Annotation> &annotations);
+	void put_word(std::vector<Annotation> &annotations);
+	void reset_word();
+
+private:
+	int clk_bit_;
+	int miso_bit_;
+	int mosi_bit_;
+	int cs_bit_;
+	uint64_t mask_;
+
+	bool cs_active_low_;
+	bool sample_on_rising_;
+	bool msb_first_;
+	unsigned int wordsize_;
+
+	int64_t next_;
+	int old_clk_;
+	int old_cs_;
+
+	unsigned int bitcount_;
+	uint64_t miso_data_;
+	uint64_t mosi_data_;
+	std::vector<int64_t> bit_samples_;
+	std::vector<unsigned int> miso_bits_;
+	std::vector<unsigned int> mosi_bits_;
+};
+
+} // namespace decode
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_NATIVESPI_HPP
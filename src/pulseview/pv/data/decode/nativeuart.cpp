@@ -0,0 +1,299 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "nativeuart.hpp"
+
+#include "../logicsegment.hpp"
+
+using std::max;
+using std::string;
+using std::vector;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+NativeUart::NativeUart(const Decoder &decoder, double samplerate,
+	int64_t start_sample) :
+	NativeDecoder(start_sample),
+	bit_width_(1.0),
+	num_data_bits_(option_int(decoder, "num_data_bits")),
+	parity_(ParityNone),
+	lsb_first_(option_string(decoder, "bit_order") != "msb-first"),
+	format_(FormatAscii)
+{
+	const int64_t baudrate = option_int(decoder, "baudrate");
+	if (baudrate > 0)
+		bit_width_ = samplerate / baudrate;
+
+	if (num_data_bits_ < 1 || num_data_bits_ > 32)
+		num_data_bits_ = 8;
+
+	const string parity = option_string(decoder, "parity_type");
+	if (parity == "odd")
+		parity_ = ParityOdd;
+	else if (parity == "even")
+		parity_ = ParityEven;
+	else if (parity == "zero")
+		parity_ = ParityZero;
+	else if (parity == "one")
+		parity_ = ParityOne;
+
+	const string format = option_string(decoder, "format");
+	if (format == "dec")
+		format_ = FormatDec;
+	else if (format == "hex")
+		format_ = FormatHex;
+	else if (format == "oct")
+		format_ = FormatOct;
+	else if (format == "bin")
+		format_ = FormatBin;
+
+	const char *const ids[2] = { "rx", "tx" };
+	const char *const inverts[2] = { "invert_rx", "invert_tx" };
+
+	for (int rxtx = 0; rxtx < 2; rxtx++) {
+		Line &line = lines_[rxtx];
+
+		line.bit = channel_bit(decoder, ids[rxtx]);
+		line.invert = option_string(decoder, inverts[rxtx]) == "yes";
+		line.rxtx = rxtx;
+		line.state = WaitForStartBit;
+		line.next = start_sample;
+		line.old_level = true;
+		line.frame_start = start_sample;
+		line.last = start_sample;
+		line.data_start = -1;
+		line.data_bit = 0;
+		line.data = 0;
+	}
+}
+
+void NativeUart::decode(const LogicSegment &segment, int64_t end_sample,
+	vector<Annotation> &annotations)
+{
+	for (Line &line : lines_)
+		if (line.bit >= 0)
+			decode_line(line, segment, end_sample, annotations);
+}
+
+void NativeUart::decode_line(Line &line, const LogicSegment &segment,
+	int64_t end_sample, vector<Annotation> &annotations)
+{
+	const uint64_t mask = 1ULL << line.bit;
+	const int rxtx = line.rxtx;
+
+	const auto level = [&](int64_t index) {
+		return (unsigned int)(((sample(segment, index) & mask) != 0) ^
+			line.invert);
+	};
+
+	for (;;) {
+		switch (line.state) {
+		case WaitForStartBit:
+			// The idle level is high, so a start bit begins with a
+			// falling edge. Only the edges need to be looked at.
+			while (line.next < end_sample) {
+				const bool l = level(line.next);
+				if (line.old_level && !l)
+					break;
+
+				line.old_level = l;
+				line.next = next_edge(segment, line.next + 1,
+					end_sample, mask);
+			}
+
+			if (line.next >= end_sample)
+				return;
+
+			line.frame_start = line.last = line.next;
+			line.state = GetStartBit;
+			break;
+
+		case GetStartBit: {
+			const int64_t s = bit_sample(line, 0);
+			if (s >= end_sample)
+				return;
+
+			if (level(s) != 0)
+				put_bit(annotations, s, rxtx + 10,
+					{"Frame error", "Frame err", "FE"});
+			put_bit(annotations, s, rxtx + 2, {"Start bit", "Start", "S"});
+
+			line.data_bit = 0;
+			line.data = 0;
+			line.data_start = -1;
+			line.last = s;
+			line.state = GetDataBits;
+			break;
+		}
+
+		case GetDataBits: {
+			const int64_t s = bit_sample(line, line.data_bit + 1);
+			if (s >= end_sample)
+				return;
+
+			const unsigned int bit = level(s);
+
+			if (line.data_start == -1)
+				line.data_start = s;
+
+			if (lsb_first_)
+				line.data = (line.data >> 1) |
+					(bit << (num_data_bits_ - 1));
+			else
+				line.data = (line.data << 1) | bit;
+
+			put_bit(annotations, s, rxtx + 12, {QString::number(bit)});
+			line.last = s;
+
+			if (line.data_bit < num_data_bits_ - 1) {
+				line.data_bit++;
+				break;
+			}
+
+			const int64_t start = line.data_start -
+				(int64_t)floor(bit_width_ / 2.0);
+			annotations.push_back(Annotation(max<int64_t>(start, 0),
+				s + (int64_t)ceil(bit_width_ / 2.0), rxtx,
+				{format_data(line.data)}));
+
+			line.state = GetParityBit;
+			break;
+		}
+
+		case GetParityBit: {
+			if (parity_ == ParityNone) {
+				// Like the Python decoder, spend one sample on
+				// this state
+				if (line.last + 1 >= end_sample)
+					return;
+
+				line.last++;
+				line.state = GetStopBits;
+				break;
+			}
+
+			const int64_t s = bit_sample(line, num_data_bits_ + 1);
+			if (s >= end_sample)
+				return;
+
+			if (parity_ok(level(s), line.data))
+				put_bit(annotations, s, rxtx + 4,
+					{"Parity bit", "Parity", "P"});
+			else
+				put_bit(annotations, s, rxtx + 6,
+					{"Parity error", "Parity err", "PE"});
+
+			line.last = s;
+			line.state = GetStopBits;
+			break;
+		}
+
+		case GetStopBits: {
+			const unsigned int bitnum = num_data_bits_ + 1 +
+				(parity_ == ParityNone ? 0 : 1);
+			const int64_t s = bit_sample(line, bitnum);
+			if (s >= end_sample)
+				return;
+
+			const bool l = level(s);
+
+			if (!l)
+				put_bit(annotations, s, rxtx + 10,
+					{"Frame error", "Frame err", "FE"});
+
+			// The Python decoder reports the stop bit with the
+			// parity OK class
+			put_bit(annotations, s, rxtx + 4, {"Stop bit", "Stop", "T"});
+
+			line.next = s + 1;
+			line.old_level = l;
+			line.state = WaitForStartBit;
+			break;
+		}
+		}
+	}
+}
+
+int64_t NativeUart::bit_sample(const Line &line, unsigned int bitnum) const
+{
+	// The first sample at or after the middle of the bit, and after the
+	// sample that was read last
+	const double bitpos = line.frame_start + (bit_width_ - 1.0) / 2.0 +
+		bitnum * bit_width_;
+
+	return max((int64_t)ceil(bitpos), line.last + 1);
+}
+
+bool NativeUart::parity_ok(unsigned int parity_bit, unsigned int data) const
+{
+	unsigned int ones = parity_bit;
+
+	for (; data; data &= data - 1)
+		ones++;
+
+	switch (parity_) {
+	case ParityZero:
+		return parity_bit == 0;
+	case ParityOne:
+		return parity_bit == 1;
+	case ParityOdd:
+		return (ones % 2) == 1;
+	case ParityEven:
+		return (ones % 2) == 0;
+	default:
+		return true;
+	}
+}
+
+QString NativeUart::format_data(unsigned int data) const
+{
+	switch (format_) {
+	case FormatDec:
+		return QString::number(data);
+	case FormatHex:
+		return QString("%1").arg(data, 2, 16, QChar('0')).toUpper();
+	case FormatOct:
+		return QString("%1").arg(data, 3, 8, QChar('0'));
+	case FormatBin:
+		return QString("%1").arg(data, 8, 2, QChar('0'));
+	default:
+		if (data >= 30 && data <= 126)
+			return QString(QChar(data));
+		return QString("[%1]").arg(data, 2, 16, QChar('0')).toUpper();
+	}
+}
+
+void NativeUart::put_bit(vector<Annotation> &annotations, int64_t samplenum,
+	int format, const vector<QString> &texts) const
+{
+	const int64_t start = samplenum - (int64_t)floor(bit_width_ / 2.0);
+
+	annotations.push_back(Annotation(max<int64_t>(start, 0),
+		samplenum + (int64_t)ceil(bit_width_ / 2.0), format, texts));
+}
+
+} // namespace decode
+} // namespace data
+} // namespace pv
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_NATIVEUART_HPP
+#define PULSEVIEW_PV_DATA_DECODE_NATIVEUART_HPP
+
+#include "nativedecoder.hpp"
+
+namespace pv {
+namespace data {
+namespace decode {
+
+/**
+ * Native version of the "uart" decoder. RX and TX are decoded as two
+ * independent lines; each one only reads the samples in the middle of
+ * its bits, and jumps from one frame to the next start bit edge.
+ */
+class NativeUart : public NativeDecoder
+{
+private:
+	enum State {
+		WaitForStartBit,
+		GetStartBit,
+		GetDataBits,
+		GetParityBit,
+		GetStopBits,
+	};
+
+	enum Parity {
+		ParityNone,
+		ParityOdd,
+		ParityEven,
+		ParityZero,
+		ParityOne,
+	};
+
+	enum Format {
+		FormatAscii,
+		FormatDec,
+		FormatHex,
+		FormatOct,
+		FormatBin,
+	};
+
+	struct Line {
+		int bit;
+		bool invert;
+		int rxtx;
+
+		State state;
+		int64_t next;		// Next sample to look at for a start bit
+		bool old_level;		// Level of the sample before next
+		int64_t frame_start;
+		int64_t last;		// Sample of the last bit read
+		int64_t data_start;
+		unsigned int data_bit;
+		unsigned int data;
+	};
+
+public:
+	NativeUart(const Decoder &decoder, double samplerate,
+		int64_t start_sample);
+
+	void decode(const LogicSegment &segment, int64_t end_sample,
+		std::vector<Annotation> &annotations);
+
+private:
+	void decode_line(Line &line, const LogicSegment &segment,
+		int64_t end_sample, std::vector<Annotation> &annotations);
+
+	int64_t bit_sample(const Line &line, unsigned int bitnum) const;
+	bool parity_ok(unsigned int parity_bit, unsigned int data) const;
+	QString format_data(unsigned int data) const;
+
+	void put_bit(std::vector<Annotation> &annotations, int64_t samplenum,
+		int format, const std::vector<QString> &texts) const;
+
+private:
+	double bit_width_;
+	unsigned int num_data_bits_;
+	Parity parity_;
+	bool lsb_first_;
+	Format format_;
+
+	Line lines_[2];
+};
+
+} // namespace decode
+} // namespace data
+} // namespace pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_NATIVEUART_HPP
@@ -18,38 +18,164 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include <algorithm>
+
 #include "rowdata.hpp"
 
+using std::max;
+using std::remove_if;
+using std::upper_bound;
 using std::vector;
 
 namespace pv {
 namespace data {
 namespace decode {
 
-RowData::RowData()
+const int RowData::SummaryScalePower = 4;
+const int RowData::SummaryScaleFactor = 1 << SummaryScalePower;
+
+RowData::RowData() :
+	max_sample_(0)
 {
 }
 
 uint64_t RowData::get_max_sample() const
 {
-	if (annotations_.empty())
-		return 0;
-	return annotations_.back().end_sample();
+	return max_sample_;
 }
 
 void RowData::get_annotation_subset(
 	vector<pv::data::decode::Annotation> &dest,
-	uint64_t start_sample, uint64_t end_sample) const
+	uint64_t start_sample, uint64_t end_sample, double min_length) const
 {
-	for (const auto& annotation : annotations_)
-		if (annotation.end_sample() > start_sample &&
-			annotation.start_sample() <= end_sample)
-			dest.push_back(annotation);
+	// Only the annotations that start up to end_sample can be in range
+	const size_t last = upper_bound(records_.begin(), records_.end(),
+		end_sample, [](uint64_t sample, const Record &r) {
+			return sample < r.start_sample; }) - records_.begin();
+
+	size_t index = 0;
+
+	while (index < last) {
+		// Climb up the summaries as long as the index is at the
+		// beginning of a run that ends before the range, or that is
+		// short enough to be merged
+		const Summary *summary = nullptr;
+		int level = -1;
+
+		while (level + 1 < (int)ScaleStepCount) {
+			const vector<Summary> &s = summaries_[level + 1];
+			const unsigned int power = (level + 2) * SummaryScalePower;
+			const size_t offset = index >> power;
+
+			if ((index & ((1ULL << power) - 1)) != 0 ||
+					offset >= s.size() ||
+					((offset + 1) << power) > last)
+				break;
+
+			if (s[offset].end_sample > start_sample &&
+					s[offset].end_sample - s[offset].start_sample >=
+					min_length)
+				break;
+
+			summary = &s[offset];
+			level++;
+		}
+
+		if (level >= 0) {
+			if (summary->end_sample > start_sample)
+				dest.push_back(Annotation(summary->start_sample,
+					summary->end_sample, summary->format,
+					vector<QString>()));
+			index += 1ULL << ((level + 1) * SummaryScalePower);
+			continue;
+		}
+
+		const Record &r = records_[index];
+		if (r.end_sample > start_sample)
+			dest.push_back(Annotation(r.start_sample, r.end_sample,
+				r.format, text_pool_.texts(r.text_id)));
+		index++;
+	}
 }
 
 void RowData::push_annotation(const Annotation &a)
 {
-	annotations_.push_back(a);
+	// The annotations are kept sorted by start sample. Decoders mostly
+	// emit them in that order, so this is usually an append.
+	const auto iter = upper_bound(records_.begin(), records_.end(),
+		a.start_sample(), [](uint64_t sample, const Record &r) {
+			return sample < r.start_sample; });
+	const size_t index = iter - records_.begin();
+
+	const Record r = {a.start_sample(), a.end_sample(), a.format(),
+		text_pool_.intern(a.annotations())};
+	records_.insert(iter, r);
+	max_sample_ = max(max_sample_, a.end_sample());
+
+	update_summaries(index);
+}
+
+void RowData::retire_annotations(uint64_t sample)
+{
+	records_.erase(remove_if(records_.begin(), records_.end(),
+		[sample](const Record &r) { return r.end_sample < sample; }),
+		records_.end());
+
+	// Drop the texts that only the retired annotations used
+	vector<bool> used(text_pool_.size());
+	max_sample_ = 0;
+	for (const Record &r : records_) {
+		used[r.text_id] = true;
+		max_sample_ = max(max_sample_, r.end_sample);
+	}
+
+	const vector<uint32_t> new_ids = text_pool_.compact(used);
+	for (Record &r : records_)
+		r.text_id = new_ids[r.text_id];
+
+	update_summaries(0);
+}
+
+void RowData::update_summaries(size_t index)
+{
+	for (unsigned int level = 0; level < ScaleStepCount; level++) {
+		vector<Summary> &s = summaries_[level];
+		const unsigned int power = (level + 1) * SummaryScalePower;
+		const size_t first = index >> power;
+		const size_t length = records_.size() >> power;
+
+		s.resize(length);
+
+		for (size_t i = first; i < length; i++) {
+			Summary &summary = s[i];
+
+			// Summarize the annotations, or the summaries of the
+			// level below
+			for (size_t j = 0; j < (size_t)SummaryScaleFactor; j++) {
+				const size_t k = i * SummaryScaleFactor + j;
+				const uint64_t start = level ?
+					summaries_[level - 1][k].start_sample :
+					records_[k].start_sample;
+				const uint64_t end = level ?
+					summaries_[level - 1][k].end_sample :
+					records_[k].end_sample;
+				const int format = level ?
+					summaries_[level - 1][k].format :
+					records_[k].format;
+
+				if (j == 0) {
+					summary.start_sample = start;
+					summary.end_sample = end;
+					summary.format = format;
+				} else {
+					summary.end_sample = max(
+						summary.end_sample, end);
+					if (format != summary.format)
+						summary.format = -1;
+				}
+			}
+		}
+	}
 }
 
 } // decode
@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "annotation.hpp"
+#include "textpool.hpp"
 
 namespace pv {
 namespace data {
@@ -31,6 +32,38 @@ namespace decode {
 
 class RowData
 {
+private:
+	/**
+	 * Fixed size record of an annotation. The texts are kept in the
+	 * row's text pool.
+	 */
+	struct Record
+	{
+		uint64_t start_sample;
+		uint64_t end_sample;
+		int32_t format;
+		uint32_t text_id;
+	};
+
+	/**
+	 * Summary of a run of consecutive annotations, in order of their
+	 * start sample. It serves both as an interval index, to skip the
+	 * annotations that end before the range of a query, and as a level
+	 * of detail summary, to merge the annotations that are too short
+	 * to be told apart.
+	 */
+	struct Summary
+	{
+		uint64_t start_sample;
+		uint64_t end_sample;
+		int format;
+	};
+
+private:
+	static const unsigned int ScaleStepCount = 8;
+	static const int SummaryScalePower;
+	static const int SummaryScaleFactor;
+
 public:
 	RowData();
 
@@ -38,16 +71,36 @@ public:
 	uint64_t get_max_sample() const;
 
 	/**
-	 * Extracts sorted annotations between two period into a vector.
+	 * Extracts the annotations between two samples into a vector,
+	 * sorted by start sample. If min_length is not zero, runs of
+	 * annotations that span less than min_length samples in total
+	 * are merged into a single annotation without text, whose format
+	 * is -1 if theirs differ.
 	 */
 	void get_annotation_subset(
 		std::vector<pv::data::decode::Annotation> &dest,
-		uint64_t start_sample, uint64_t end_sample) const;
+		uint64_t start_sample, uint64_t end_sample,
+		double min_length = 0) const;
 
 	void push_annotation(const Annotation &a);
 
+	/**
+	 * Removes the annotations that end before the given sample.
+	 */
+	void retire_annotations(uint64_t sample);
+
+private:
+	/**
+	 * Recomputes the summaries of the runs from the given annotation
+	 * index onwards.
+	 */
+	void update_summaries(size_t index);
+
 private:
-	std::vector<Annotation> annotations_;
+	std::vector<Record> records_;
+	TextPool text_pool_;
+	std::vector<Summary> summaries_[ScaleStepCount];
+	uint64_t max_sample_;
 };
 
 }
@@ -0,0 +1,96 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <cassert>
+
+#include <boost/functional/hash.hpp>
+
+#include <QHash>
+
+#include "textpool.hpp"
+
+using std::make_pair;
+using std::vector;
+
+namespace pv {
+namespace data {
+namespace decode {
+
+uint32_t TextPool::intern(const vector<QString> &texts)
+{
+	const size_t h = hash(texts);
+
+	const auto range = index_.equal_range(h);
+	for (auto iter = range.first; iter != range.second; iter++)
+		if (texts_[(*iter).second] == texts)
+			return (*iter).second;
+
+	const uint32_t id = texts_.size();
+	texts_.push_back(texts);
+	index_.insert(make_pair(h, id));
+
+	return id;
+}
+
+const vector<QString>& TextPool::texts(uint32_t id) const
+{
+	assert(id < texts_.size());
+	return texts_[id];
+}
+
+size_t TextPool::size() const
+{
+	return texts_.size();
+}
+
+vector<uint32_t> TextPool::compact(const vector<bool> &used)
+{
+	assert(used.size() == texts_.size());
+
+	vector<uint32_t> new_ids(texts_.size());
+	uint32_t id = 0;
+
+	index_.clear();
+
+	for (uint32_t i = 0; i < texts_.size(); i++) {
+		if (!used[i])
+			continue;
+
+		if (id != i)
+			texts_[id].swap(texts_[i]);
+		index_.insert(make_pair(hash(texts_[id]), id));
+		new_ids[i] = id++;
+	}
+
+	texts_.resize(id);
+	texts_.shrink_to_fit();
+
+	return new_ids;
+}
+
+size_t TextPool::hash(const vector<QString> &texts)
+{
+	size_t seed = 0;
+	for (const QString &text : texts)
+		boost::hash_combine(seed, qHash(text));
+	return seed;
+}
+
+} // decode
+} // data
+} // pv
@@ -0,0 +1,71 @@
+/*
+ * This file is part of the PulseView project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef PULSEVIEW_PV_DATA_DECODE_TEXTPOOL_HPP
+#define PULSEVIEW_PV_DATA_DECODE_TEXTPOOL_HPP
+
+#include <stdint.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <QString>
+
+namespace pv {
+namespace data {
+namespace decode {
+
+/**
+ * Deduplicated storage for the texts of annotations. Decoders repeat the
+ * same few texts over and over ("Start bit", "0x41", ...), so each
+ * distinct list of texts is stored once and annotations refer to it by
+ * id.
+ */
+class TextPool
+{
+public:
+	/**
+	 * Returns the id of the given texts, adding them to the pool if
+	 * they are not in it yet.
+	 */
+	uint32_t intern(const std::vector<QString> &texts);
+
+	const std::vector<QString>& texts(uint32_t id) const;
+
+	size_t size() const;
+
+	/**
+	 * Drops the texts that are not used any more and renumbers the rest.
+	 * @param used For each id, whether it is still in use.
+	 * @return The new id of each text that is still in use, by old id.
+	 */
+	std::vector<uint32_t> compact(const std::vector<bool> &used);
+
+private:
+	static size_t hash(const std::vector<QString> &texts);
+
+private:
+	std::vector< std::vector<QString> > texts_;
+	std::unordered_multimap<size_t, uint32_t> index_;
+};
+
+} // decode
+} // data
+} // pv
+
+#endif // PULSEVIEW_PV_DATA_DECODE_TEXTPOOL_HPP
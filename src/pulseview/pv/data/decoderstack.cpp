@@ -30,6 +30,7 @@
 #include "../data/logicsegment.hpp"
 #include "../data/decode/decoder.hpp"
 #include "../data/decode/annotation.hpp"
+#include "../data/decode/nativedecoder.hpp"
 #include "../session.hpp"
 #include "../view/logicsignal.hpp"
 
@@ -45,6 +46,7 @@ using std::list;
 using std::map;
 using std::pair;
 using std::shared_ptr;
+using std::unique_ptr;
 using std::vector;
 
 using namespace pv::data::decode;
@@ -67,7 +69,10 @@ DecoderStack::DecoderStack(pv::Session &session,
 	sample_count_(0),
 	frame_complete_(false),
 	samples_decoded_(0),
-	active_decode_index_(0)
+	active_decode_index_(0),
+	streaming_(false),
+	session_start_(0),
+	retired_sample_(0)
 {
 	connect(&session_, SIGNAL(frame_began()),
 		this, SLOT(on_new_frame()));
@@ -155,6 +160,14 @@ const pv::util::Timestamp& DecoderStack::start_time() const
 int64_t DecoderStack::samples_decoded() const
 {
 	lock_guard<mutex> decode_lock(output_mutex_);
+
+	// Once the ring buffer has wrapped around, the decoded samples are
+	// not at the start of the segment anymore. The decode is meant to
+	// keep up with the capture, so report it as complete.
+	if (streaming_ && segment_ &&
+			samples_decoded_ >= (int64_t)segment_->get_sample_count())
+		return segment_->get_sample_count();
+
 	return samples_decoded_;
 }
 
@@ -188,17 +201,62 @@ std::vector<Row> DecoderStack::get_visible_rows() const
 	return rows;
 }
 
+/**
+ * Gets the annotations of the samples [start_sample, end_sample) of the
+ * segment, where the first sample of the segment is sample number offset.
+ */
+static void get_annotation_subset_at(vector<Annotation> &dest,
+	const RowData &row_data, uint64_t start_sample, uint64_t end_sample,
+	double min_length, uint64_t offset)
+{
+	const size_t first = dest.size();
+
+	row_data.get_annotation_subset(dest, start_sample + offset,
+		end_sample + offset, min_length);
+
+	for (size_t i = first; i < dest.size(); i++) {
+		const Annotation &a = dest[i];
+		dest[i] = Annotation(
+			a.start_sample() > offset ? a.start_sample() - offset : 0,
+			a.end_sample() - offset, a.format(), a.annotations());
+	}
+}
+
 void DecoderStack::get_annotation_subset(
 	std::vector<pv::data::decode::Annotation> &dest,
 	const Row &row, uint64_t start_sample,
-	uint64_t end_sample) const
+	uint64_t end_sample, double min_length) const
 {
 	lock_guard<mutex> lock(output_mutex_);
 
 	const auto iter = rows_.find(row);
-	if (iter != rows_.end())
-		(*iter).second.get_annotation_subset(dest,
-			start_sample, end_sample);
+	if (iter == rows_.end())
+		return;
+
+	const RowData &row_data = (*iter).second;
+	const uint64_t count = segment_ ? segment_->get_sample_count() : 0;
+	const uint64_t total = (streaming_ && segment_) ?
+		segment_->get_total_sample_count() : 0;
+
+	if (total <= count) {
+		row_data.get_annotation_subset(dest, start_sample, end_sample,
+			min_length);
+		return;
+	}
+
+	// The ring buffer has wrapped around: the samples before the active
+	// index are from the current lap, the ones after it from the
+	// previous one
+	const uint64_t active = total % count;
+	const uint64_t lap = total - active;
+
+	if (start_sample < active)
+		get_annotation_subset_at(dest, row_data, start_sample,
+			min(end_sample, active), min_length, lap);
+	if (end_sample >= active)
+		get_annotation_subset_at(dest, row_data,
+			max(start_sample, active), end_sample, min_length,
+			lap - count);
 }
 
 QString DecoderStack::error_message()
@@ -212,6 +270,7 @@ void DecoderStack::clear()
 	sample_count_ = 0;
 	frame_complete_ = false;
 	samples_decoded_ = 0;
+	retired_sample_ = 0;
 	error_message_ = QString();
 	rows_.clear();
 	class_rows_.clear();
@@ -219,9 +278,6 @@ void DecoderStack::clear()
 
 void DecoderStack::begin_decode()
 {
-	shared_ptr<pv::view::LogicSignal> logic_signal;
-	shared_ptr<pv::data::Logic> data;
-
 	if (decode_thread_.joinable()) {
 		interrupt_ = true;
 		input_cond_.notify_one();
@@ -268,24 +324,12 @@ void DecoderStack::begin_decode()
 		}
 	}
 
-	// We get the logic data of the first channel in the list.
-	// This works because we are currently assuming all
-	// LogicSignals have the same data/segment
-	for (const shared_ptr<decode::Decoder> &dec : stack_)
-		if (dec && !dec->channels().empty() &&
-			((logic_signal = (*dec->channels().begin()).second)) &&
-			((data = logic_signal->logic_data())))
-			break;
-
-	if (!data)
-		return;
-
 	// Check we have a segment of data
-	const deque< shared_ptr<pv::data::LogicSegment> > &segments =
-		data->logic_segments();
-	if (segments.empty())
+	segment_ = find_segment();
+	if (!segment_)
 		return;
-	segment_ = segments.front();
+
+	streaming_ = session_.is_screen_mode();
 
 	// Get the samplerate and start time
 	start_time_ = segment_->start_time();
@@ -305,16 +349,48 @@ uint64_t DecoderStack::max_sample_count() const
 		max_sample_count = max(max_sample_count,
 			row.second.get_max_sample());
 
+	// In stream mode the annotations are numbered from the start of the
+	// capture, which goes on past the end of the segment
+	if (streaming_ && segment_)
+		max_sample_count = min(max_sample_count,
+			segment_->get_sample_count());
+
 	return max_sample_count;
 }
 
+shared_ptr<LogicSegment> DecoderStack::find_segment() const
+{
+	shared_ptr<pv::view::LogicSignal> logic_signal;
+	shared_ptr<pv::data::Logic> data;
+
+	// We get the logic data of the first channel in the list.
+	// This works because we are currently assuming all
+	// LogicSignals have the same data/segment
+	for (const shared_ptr<decode::Decoder> &dec : stack_)
+		if (dec && !dec->channels().empty() &&
+			((logic_signal = (*dec->channels().begin()).second)) &&
+			((data = logic_signal->logic_data())))
+			break;
+
+	if (!data)
+		return nullptr;
+
+	const deque< shared_ptr<pv::data::LogicSegment> > &segments =
+		data->logic_segments();
+	if (segments.empty())
+		return nullptr;
+
+	return segments.front();
+}
+
 optional<int64_t> DecoderStack::wait_for_data() const
 {
 	unique_lock<mutex> input_lock(input_mutex_);
 
 	// Do wait if we decoded all samples but we're still capturing
-	// Do not wait if we're done capturing
-	while (!interrupt_ && !frame_complete_ &&
+	// Do not wait if we're done capturing. In stream mode the frames
+	// keep coming into the same segment, so their end doesn't count.
+	while (!interrupt_ && (!frame_complete_ || streaming_) &&
 		(samples_decoded_ >= sample_count_) &&
 		(session_.get_capture_state() != Session::Stopped)) {
 
@@ -324,13 +400,54 @@ optional<int64_t> DecoderStack::wait_for_data() const
 	// Return value is valid if we're not aborting the decode,
 	return boost::make_optional(!interrupt_ &&
 		// and there's more work to do...
-		(samples_decoded_ < sample_count_ || !frame_complete_) &&
+		(samples_decoded_ < sample_count_ || !frame_complete_ ||
+			streaming_) &&
 		// and if the end of the data hasn't been reached yet
 		(!((samples_decoded_ >= sample_count_) && (session_.get_capture_state() == Session::Stopped))),
 		sample_count_);
 }
 
-void DecoderStack::decode_data(
+int64_t DecoderStack::oldest_sample() const
+{
+	const int64_t sample_count = segment_->get_sample_count();
+	return max<int64_t>(
+		segment_->get_total_sample_count() - sample_count, 0);
+}
+
+bool DecoderStack::get_samples(uint8_t *const data,
+	int64_t start_sample, int64_t end_sample) const
+{
+	const int64_t sample_count = segment_->get_sample_count();
+	const int64_t index = start_sample % sample_count;
+	const int64_t length = min(end_sample - start_sample,
+		sample_count - index);
+
+	segment_->get_samples(data, index, index + length);
+
+	// The samples may wrap around the end of the ring buffer
+	if (length < end_sample - start_sample)
+		segment_->get_samples(data + length * segment_->unit_size(),
+			0, end_sample - start_sample - length);
+
+	return start_sample >= oldest_sample();
+}
+
+void DecoderStack::retire_annotations()
+{
+	// This is done a quarter of the segment at a time, so that it
+	// costs in proportion to the new data
+	const int64_t oldest = oldest_sample();
+	if (oldest < retired_sample_ +
+			(int64_t)segment_->get_sample_count() / 4)
+		return;
+
+	for (auto& row : rows_)
+		row.second.retire_annotations(oldest);
+
+	retired_sample_ = oldest;
+}
+
+bool DecoderStack::decode_data(
 	const int64_t sample_count, const unsigned int unit_size,
 	srd_session *const session)
 {
@@ -344,10 +461,19 @@ void DecoderStack::decode_data(
 
 		const int64_t chunk_end = min(
 			i + chunk_sample_count, sample_count);
-		segment_->get_samples(chunk, i, chunk_end);
+		if (!get_samples(chunk, i, chunk_end))
+			return false;
 
-		if (srd_session_send(session, i, chunk_end, chunk,
-				(chunk_end - i) * unit_size, unit_size) != SRD_OK) {
+		// The session numbers the samples from its start
+		int ret;
+		{
+			lock_guard<mutex> srd_lock(global_srd_mutex_);
+			ret = srd_session_send(session, i - session_start_,
+				chunk_end - session_start_, chunk,
+				(chunk_end - i) * unit_size, unit_size);
+		}
+
+		if (ret != SRD_OK) {
 			error_message_ = tr("Decoder reported an error");
 			break;
 		}
@@ -355,6 +481,9 @@ void DecoderStack::decode_data(
 		{
 			lock_guard<mutex> lock(output_mutex_);
 			samples_decoded_ = chunk_end;
+
+			if (streaming_)
+				retire_annotations();
 		}
 
 		if (i % DecodeNotifyPeriod == 0)
@@ -364,16 +493,59 @@ void DecoderStack::decode_data(
 	}
 
 	new_decode_data();
+
+	return true;
 }
 
-void DecoderStack::decode_proc()
+void DecoderStack::decode_native(const int64_t sample_count,
+	unique_ptr<NativeDecoder> &decoder)
+{
+	vector<Annotation> annotations;
+	const shared_ptr<decode::Decoder> &dec = stack_.front();
+
+	for (int64_t i = active_decode_index_; !interrupt_ && i < sample_count;
+			i = active_decode_index_) {
+
+		const int64_t chunk_end = min(
+			i + DecodeChunkLength, sample_count);
+
+		annotations.clear();
+		decoder->decode(*segment_, chunk_end, annotations);
+
+		// If the capture has overwritten the samples before they
+		// could be decoded, start over from the oldest one left
+		const int64_t oldest = oldest_sample();
+		if (i < oldest) {
+			decoder = NativeDecoder::create(*dec, samplerate_,
+				oldest);
+			assert(decoder);
+			active_decode_index_ = oldest;
+			continue;
+		}
+
+		{
+			lock_guard<mutex> lock(output_mutex_);
+
+			for (const Annotation &a : annotations)
+				push_annotation(dec->decoder(), a);
+
+			samples_decoded_ = chunk_end;
+
+			if (streaming_)
+				retire_annotations();
+		}
+
+		new_decode_data();
+
+		active_decode_index_ = chunk_end;
+	}
+}
+
+srd_session* DecoderStack::start_session()
 {
-	optional<int64_t> sample_count;
 	srd_session *session;
 	srd_decoder_inst *prev_di = nullptr;
 
-	assert(segment_);
-
 	// Prevent any other decode threads from accessing libsigrokdecode
 	lock_guard<mutex> srd_lock(global_srd_mutex_);
 
@@ -382,15 +554,13 @@ void DecoderStack::decode_proc()
 	assert(session);
 
 	// Create the decoders
-	const unsigned int unit_size = segment_->unit_size();
-
 	for (const shared_ptr<decode::Decoder> &dec : stack_) {
 		srd_decoder_inst *const di = dec->create_decoder_inst(session);
 
 		if (!di) {
 			error_message_ = tr("Failed to create decoder instance");
 			srd_session_destroy(session);
-			return;
+			return nullptr;
 		}
 
 		if (prev_di)
@@ -399,12 +569,6 @@ void DecoderStack::decode_proc()
 		prev_di = di;
 	}
 
-	// Get the intial sample count
-	{
-		unique_lock<mutex> input_lock(input_mutex_);
-		sample_count = sample_count_ = segment_->get_sample_count();
-	}
-
 	// Start the session
 	srd_session_metadata_set(session, SRD_CONF_SAMPLERATE,
 		g_variant_new_uint64((uint64_t)samplerate_));
@@ -414,11 +578,67 @@ void DecoderStack::decode_proc()
 
 	srd_session_start(session);
 
+	session_start_ = active_decode_index_;
+
+	return session;
+}
+
+void DecoderStack::decode_proc()
+{
+	optional<int64_t> sample_count;
+	srd_session *session;
+
+	assert(segment_);
+
+	// Get the intial sample count
+	{
+		unique_lock<mutex> input_lock(input_mutex_);
+		sample_count = sample_count_ = streaming_ ?
+			segment_->get_total_sample_count() :
+			segment_->get_sample_count();
+	}
+
+	// Start with the oldest sample still in the segment
+	active_decode_index_ = oldest_sample();
+
+	// A single decoder with a native implementation doesn't need
+	// libsigrokdecode at all
+	unique_ptr<NativeDecoder> native;
+	if (stack_.size() == 1 && stack_.front()->native())
+		native = NativeDecoder::create(*stack_.front(), samplerate_,
+			active_decode_index_);
+
+	if (native) {
+		do {
+			decode_native(*sample_count, native);
+		} while ((sample_count = wait_for_data()));
+
+		return;
+	}
+
+	const unsigned int unit_size = segment_->unit_size();
+
+	if (!(session = start_session()))
+		return;
+
 	do {
-		decode_data(*sample_count, unit_size, session);
+		if (decode_data(*sample_count, unit_size, session))
+			continue;
+
+		// The capture has overwritten the samples before they could
+		// be decoded, start over from the oldest one left
+		{
+			lock_guard<mutex> srd_lock(global_srd_mutex_);
+			srd_session_destroy(session);
+		}
+
+		active_decode_index_ = oldest_sample();
+		if (!(session = start_session()))
+			return;
 	} while (error_message_.isEmpty() && (sample_count = wait_for_data()));
 
 	// Destroy the session
+	lock_guard<mutex> srd_lock(global_srd_mutex_);
 	srd_session_destroy(session);
 }
 
@@ -432,27 +652,32 @@ void DecoderStack::annotation_callback(srd_proto_data *pdata, void *decoder)
 
 	lock_guard<mutex> lock(d->output_mutex_);
 
-	const Annotation a(pdata);
+	const Annotation a(pdata, d->session_start_);
 
-	// Find the row
 	assert(pdata->pdo);
 	assert(pdata->pdo->di);
-	const srd_decoder *const decc = pdata->pdo->di->decoder;
+	d->push_annotation(pdata->pdo->di->decoder, a);
+}
+
+void DecoderStack::push_annotation(const srd_decoder *const decc,
+	const Annotation &a)
+{
 	assert(decc);
 
-	auto row_iter = d->rows_.end();
+	// Find the row
+	auto row_iter = rows_.end();
 
 	// Try looking up the sub-row of this class
-	const auto r = d->class_rows_.find(make_pair(decc, a.format()));
-	if (r != d->class_rows_.end())
-		row_iter = d->rows_.find((*r).second);
+	const auto r = class_rows_.find(make_pair(decc, a.format()));
+	if (r != class_rows_.end())
+		row_iter = rows_.find((*r).second);
 	else {
 		// Failing that, use the decoder as a key
-		row_iter = d->rows_.find(Row(decc));	
+		row_iter = rows_.find(Row(decc));
 	}
 
-	assert(row_iter != d->rows_.end());
-	if (row_iter == d->rows_.end()) {
+	assert(row_iter != rows_.end());
+	if (row_iter == rows_.end()) {
 		qDebug() << "Unexpected annotation: decoder = " << decc <<
 			", format = " << a.format();
 		assert(0);
@@ -465,6 +690,18 @@ void DecoderStack::annotation_callback(srd_proto_data *pdata, void *decoder)
 
 void DecoderStack::on_new_frame()
 {
+	// In stream mode the frames keep going into the same segment, so
+	// the decode carries on where it is
+	if (streaming_ && decode_thread_.joinable() &&
+			error_message().isEmpty() && segment_ == find_segment()) {
+		{
+			unique_lock<mutex> lock(input_mutex_);
+			frame_complete_ = false;
+		}
+		input_cond_.notify_one();
+		return;
+	}
+
 	begin_decode();
 }
 
@@ -473,7 +710,9 @@ void DecoderStack::on_data_received()
 	{
 		unique_lock<mutex> lock(input_mutex_);
 		if (segment_)
-			sample_count_ = segment_->get_sample_count();
+			sample_count_ = streaming_ ?
+				segment_->get_total_sample_count() :
+				segment_->get_sample_count();
 	}
 	input_cond_.notify_one();
 }
@@ -64,6 +64,7 @@ class LogicSegment;
 namespace decode {
 class Annotation;
 class Decoder;
+class NativeDecoder;
 }
 
 class Logic;
@@ -100,11 +101,13 @@ public:
 
 	/**
 	 * Extracts sorted annotations between two period into a vector.
+	 * Runs of annotations shorter than min_length samples are merged,
+	 * see decode::RowData::get_annotation_subset().
 	 */
 	void get_annotation_subset(
 		std::vector<pv::data::decode::Annotation> &dest,
 		const decode::Row &row, uint64_t start_sample,
-		uint64_t end_sample) const;
+		uint64_t end_sample, double min_length = 0) const;
 
 	QString error_message();
 
@@ -117,16 +120,56 @@ public:
 	QString name();
 
 private:
+	std::shared_ptr<pv::data::LogicSegment> find_segment() const;
+
 	boost::optional<int64_t> wait_for_data() const;
 
-	void decode_data(const int64_t sample_count,
+	/**
+	 * Returns the number of the oldest sample still in the segment.
+	 * In stream mode the capture overwrites the samples once the
+	 * segment is full.
+	 */
+	int64_t oldest_sample() const;
+
+	/**
+	 * Copies samples, counted from the start of the capture, out of
+	 * the segment. Returns false if they have been overwritten by the
+	 * capture in the meantime.
+	 */
+	bool get_samples(uint8_t *const data, int64_t start_sample,
+		int64_t end_sample) const;
+
+	/**
+	 * Drops the annotations of the samples that the capture has
+	 * overwritten. The caller must hold output_mutex_.
+	 */
+	void retire_annotations();
+
+	/**
+	 * Creates and starts a libsigrokdecode session for the stack. The
+	 * session numbers the samples from active_decode_index_.
+	 */
+	srd_session* start_session();
+
+	/**
+	 * Sends the samples up to sample_count to the session. Returns
+	 * false if the decode fell behind the capture and has to start
+	 * over with a new session.
+	 */
+	bool decode_data(const int64_t sample_count,
 		const unsigned int unit_size, srd_session *const session);
 
+	void decode_native(const int64_t sample_count,
+		std::unique_ptr<decode::NativeDecoder> &decoder);
+
 	void decode_proc();
 
 	static void annotation_callback(srd_proto_data *pdata,
 		void *decoder);
 
+	void push_annotation(const srd_decoder *const decc,
+		const decode::Annotation &a);
+
 private Q_SLOTS:
 	void on_new_frame();
 
@@ -144,10 +187,11 @@ private:
 	double samplerate_;
 
 	/**
-	 * This mutex prevents more than one thread from accessing
-	 * libsigrokdecode concurrently.
-	 * @todo A proper solution should be implemented to allow multiple
-	 * decode operations in parallel.
+	 * This mutex prevents more than one decode thread from calling into
+	 * libsigrokdecode, and so into the Python interpreter, at a time.
+	 * It is held per session setup and per chunk sent, so the stacks
+	 * can still fetch their samples and store their annotations
+	 * concurrently.
 	 */
 	static std::mutex global_srd_mutex_;
 
@@ -164,6 +208,16 @@ private:
 	int64_t	samples_decoded_;
 	int64_t active_decode_index_;
 
+	/**
+	 * In stream mode the segment is a ring buffer that the capture
+	 * keeps filling. The decode then runs for as long as the capture
+	 * does, and only keeps the annotations of the samples that are
+	 * still in the segment.
+	 */
+	bool streaming_;
+	int64_t session_start_;
+	int64_t retired_sample_;
+
 	std::map<const decode::Row, decode::RowData> rows_;
 
 	std::map<std::pair<const srd_decoder*, int>, decode::Row> class_rows_;
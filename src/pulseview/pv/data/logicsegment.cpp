@@ -49,8 +49,7 @@ const uint64_t LogicSegment::MipMapDataUnit = 64*1024;	// bytes
 LogicSegment::LogicSegment(shared_ptr<Logic> logic, uint64_t samplerate,
 				const uint64_t expected_num_samples) :
 	Segment(samplerate, logic->unit_size()),
-	last_append_sample_(0),
-	replace_mode(false)
+	last_append_sample_(0)
 {
 	set_capacity(expected_num_samples);
 
@@ -148,7 +147,7 @@ void LogicSegment::append_payload(shared_ptr<Logic> logic)
 
 	append_data(logic->data_pointer(),
 		logic->data_length() / unit_size_);
-	replace_mode = false;
+
 	// Generate the first mip-map from the data
 	append_payload_to_mipmap();
 }
@@ -158,11 +157,20 @@ void LogicSegment::replace_payload(shared_ptr<Logic> logic)
 	assert(unit_size_ ==  logic->unit_size());
 	assert((logic->data_length() % unit_size_) == 0);
 	lock_guard<recursive_mutex> lock(mutex_);
-	uint64_t previous_active_index = get_active_sample_index();
-	replace_data(logic->data_pointer(), logic->data_length() / unit_size_);
-
-	replace_mode = true;
-	append_payload_to_mipmap(previous_active_index);
+	const uint64_t samples = logic->data_length() / unit_size_;
+	const uint64_t prev_active = get_active_sample_index();
+	replace_data(logic->data_pointer(), samples);
+
+	// The new samples may wrap around the end of the buffer
+	const uint64_t start = prev_active % sample_count_;
+	if (samples >= sample_count_) {
+		update_mipmap(0, sample_count_);
+	} else if (start + samples > sample_count_) {
+		update_mipmap(start, sample_count_);
+		update_mipmap(0, active_sample_index_);
+	} else {
+		update_mipmap(start, start + samples);
+	}
 }
 
 void LogicSegment::get_samples(uint8_t *const data,
@@ -194,7 +202,7 @@ void LogicSegment::reallocate_mipmap_level(MipMapLevel &m)
 	}
 }
 
-void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
+void LogicSegment::append_payload_to_mipmap()
 {
 	MipMapLevel &m0 = mip_map_[0];
 	uint64_t prev_index;
@@ -204,17 +212,10 @@ void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
 	uint64_t accumulator;
 	unsigned int diff_counter;
 
-	if(replace_mode)
-	{
-		prev_index = (prev_active > active_sample_index_) ? 0 : prev_active / MipMapScaleFactor;
-		end_index = active_sample_index_ / MipMapScaleFactor;
-	}
-	else {
-		// Expand the data buffer to fit the new samples
-		prev_index = m0.length;
-		m0.length = sample_count_ / MipMapScaleFactor;
-		end_index = m0.length;
-	}
+	// Expand the data buffer to fit the new samples
+	prev_index = m0.length;
+	m0.length = sample_count_ / MipMapScaleFactor;
+	end_index = m0.length;
 
 	// Break off if there are no new samples to compute
 	if (m0.length == prev_index)
@@ -249,16 +250,10 @@ void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
 		MipMapLevel &m = mip_map_[level];
 		const MipMapLevel &ml = mip_map_[level-1];
 
-		if(replace_mode) {
-			end_index = end_index / MipMapScaleFactor;
-			prev_index =  prev_index / MipMapScaleFactor;
-		}
-		else {
-			// Expand the data buffer to fit the new samples
-			prev_index = m.length;
-			m.length = ml.length / MipMapScaleFactor;
-			end_index = m.length;
-		}
+		// Expand the data buffer to fit the new samples
+		prev_index = m.length;
+		m.length = ml.length / MipMapScaleFactor;
+		end_index = m.length;
 
 		// Break off if there are no more samples to computed
 		if (m.length == prev_index)
@@ -287,6 +282,56 @@ void LogicSegment::append_payload_to_mipmap(uint64_t prev_active)
 	}
 }
 
+void LogicSegment::update_mipmap(uint64_t start, uint64_t end)
+{
+	if (start >= end)
+		return;
+
+	// Recompute every block that overlaps the rewritten samples. The
+	// blocks straddling the ends also cover samples of the previous
+	// lap, which can only make them report transitions that aren't
+	// there, never hide one.
+	uint64_t first = start / MipMapScaleFactor;
+	uint64_t last = (end + MipMapScaleFactor - 1) / MipMapScaleFactor;
+
+	const MipMapLevel &m0 = mip_map_[0];
+	for (uint64_t i = first; i < min(last, m0.length); i++) {
+		const uint64_t block = i * MipMapScaleFactor;
+
+		// The buffer is full, so the sample before the first one is
+		// the last one of the previous lap
+		uint64_t prev = get_sample(block ? block - 1 : sample_count_ - 1);
+		uint64_t accumulator = 0;
+
+		for (uint64_t j = block; j < block + MipMapScaleFactor; j++) {
+			const uint64_t sample = get_sample(j);
+			accumulator |= prev ^ sample;
+			prev = sample;
+		}
+
+		pack_sample((uint8_t*)m0.data + i * unit_size_, accumulator);
+	}
+
+	for (unsigned int level = 1; level < ScaleStepCount; level++) {
+		const MipMapLevel &m = mip_map_[level];
+		const MipMapLevel &ml = mip_map_[level-1];
+
+		first /= MipMapScaleFactor;
+		last = (last + MipMapScaleFactor - 1) / MipMapScaleFactor;
+
+		for (uint64_t i = first; i < min(last, m.length); i++) {
+			uint64_t accumulator = 0;
+
+			for (uint64_t j = i * MipMapScaleFactor;
+					j < (i + 1) * MipMapScaleFactor; j++)
+				accumulator |= get_subsample(level - 1, j);
+
+			pack_sample((uint8_t*)m.data + i * unit_size_,
+				accumulator);
+		}
+	}
+}
+
 uint64_t LogicSegment::get_sample(uint64_t index) const
 {
 	assert(index < sample_count_);
@@ -476,6 +521,48 @@ void LogicSegment::get_subsampled_edges(
 	edges.push_back(pair<int64_t, bool>(end + 1, end_sample));
 }
 
+uint64_t LogicSegment::find_next_edge(uint64_t start, uint64_t end,
+	uint64_t sig_mask) const
+{
+	assert(start > 0);
+	assert(end <= get_sample_count());
+
+	lock_guard<recursive_mutex> lock(mutex_);
+
+	const uint64_t last_sample = get_sample(start - 1) & sig_mask;
+	uint64_t index = start;
+
+	while (index < end) {
+		// Climb up the mip map as long as the index is at the
+		// beginning of a block that has no transitions
+		int level = -1;
+		while (level + 1 < (int)ScaleStepCount) {
+			const MipMapLevel &m = mip_map_[level + 1];
+			const unsigned int power = (level + 2) * MipMapScalePower;
+			const uint64_t offset = index >> power;
+
+			if ((index & ((1ULL << power) - 1)) != 0 || !m.data ||
+					offset >= m.length ||
+					(get_subsample(level + 1, offset) & sig_mask))
+				break;
+
+			level++;
+		}
+
+		if (level >= 0) {
+			index += 1ULL << ((level + 1) * MipMapScalePower);
+			continue;
+		}
+
+		if ((get_sample(index) & sig_mask) != last_sample)
+			return index;
+
+		index++;
+	}
+
+	return end;
+}
+
 uint64_t LogicSegment::get_subsample(int level, uint64_t offset) const
 {
 	assert(level >= 0);
@@ -80,9 +80,13 @@ private:
 	
 	void reallocate_mipmap_level(MipMapLevel &m);
 
-	void append_payload_to_mipmap(uint64_t prev_active=0);
-
+	void append_payload_to_mipmap();
 
+	/**
+	 * Updates the mip map after the samples in [start, end) have been
+	 * overwritten, when the segment is used as a ring buffer.
+	 */
+	void update_mipmap(uint64_t start, uint64_t end);
 
 public:
 	/**
@@ -99,6 +103,19 @@ public:
 		uint64_t start, uint64_t end,
 		float min_length, int sig_index);
 
+	/**
+	 * Finds the next transition of any of the given signals. Blocks
+	 * of samples without transitions are skipped using the mip map, so
+	 * the cost depends on the number of edges, not of samples.
+	 * @param[in] start The first sample index to look at, at least 1.
+	 * @param[in] end The end sample index.
+	 * @param[in] sig_mask The mask of the signals to look at.
+	 * @return The index of the first sample in [start, end) that
+	 * differs from the previous one, or end if there is none.
+	 */
+	uint64_t find_next_edge(uint64_t start, uint64_t end,
+		uint64_t sig_mask) const;
+
 private:
 	uint64_t get_subsample(int level, uint64_t offset) const;
 
@@ -107,7 +124,6 @@ private:
 private:
 	struct MipMapLevel mip_map_[ScaleStepCount];
 	uint64_t last_append_sample_;
-	bool replace_mode;
 
 	friend struct LogicSegmentTest::Pow2;
 	friend struct LogicSegmentTest::Basic;
@@ -54,6 +54,12 @@ uint64_t Segment::get_sample_count() const
 	return sample_count_;
 }
 
+uint64_t Segment::get_total_sample_count() const
+{
+	lock_guard<recursive_mutex> lock(mutex_);
+	return total_sample_count_;
+}
+
 uint64_t Segment::get_active_sample_index()
 {
 	return active_sample_index_;
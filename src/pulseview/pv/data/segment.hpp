@@ -37,6 +37,14 @@ public:
 
 	uint64_t get_sample_count() const;
 
+	/**
+	 * Gets the number of samples received since the segment was
+	 * created. Once the segment is used as a ring buffer this keeps
+	 * growing while the sample count stays at the capacity, and
+	 * sample n is found at index n % get_sample_count().
+	 */
+	uint64_t get_total_sample_count() const;
+
 	uint64_t get_active_sample_index();
 
 	const pv::util::Timestamp& start_time() const;
@@ -34,6 +34,7 @@ extern "C" {
 
 #include <QAction>
 #include <QApplication>
+#include <QCheckBox>
 #include <QComboBox>
 #include <QFormLayout>
 #include <QLabel>
@@ -48,6 +49,7 @@ extern "C" {
 #include "../strnatcmp.hpp"
 #include "../data/decoderstack.hpp"
 #include "../data/decode/decoder.hpp"
+#include "../data/decode/nativedecoder.hpp"
 #include "../data/logic.hpp"
 #include "../data/logicsegment.hpp"
 #include "../data/decode/annotation.hpp"
@@ -153,6 +155,8 @@ DecodeTrace::DecodeTrace(pv::Session &session,
 		this, SLOT(on_delete_decoder(int)));
 	connect(&show_hide_mapper_, SIGNAL(mapped(int)),
 		this, SLOT(on_show_hide_decoder(int)));
+	connect(&native_mapper_, SIGNAL(mapped(int)),
+		this, SLOT(on_native_decoder(int)));
 }
 
 bool DecodeTrace::enabled() const
@@ -225,6 +229,13 @@ void DecodeTrace::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 	pair<uint64_t, uint64_t> sample_range = get_sample_range(
 		pp.left(), pp.right());
 
+	// Annotations shorter than a pixel are merged before they get here
+	double samples_per_pixel, pixels_offset;
+	tie(pixels_offset, samples_per_pixel) =
+		get_pixels_offset_samples_per_pixel();
+
+	vector<Annotation> annotations;
+
 	assert(decoder_stack_);
 	const vector<Row> rows(decoder_stack_->get_visible_rows());
 
@@ -248,9 +259,10 @@ void DecodeTrace::paint_mid(QPainter &p, const ViewItemPaintParams &pp)
 		boost::hash_combine(base_colour, row.row());
 		base_colour >>= 16;
 
-		vector<Annotation> annotations;
+		annotations.clear();
 		decoder_stack_->get_annotation_subset(annotations, row,
-			sample_range.first,sample_range.second);
+			sample_range.first, sample_range.second,
+			samples_per_pixel);
 		if (!annotations.empty()) {
 			draw_annotations(annotations, p, annotation_height, pp, y,
 				base_colour, row_title_width);
@@ -380,27 +392,25 @@ QMenu* DecodeTrace::create_context_menu(QWidget *parent)
 	return menu;
 }
 
-void DecodeTrace::draw_annotations(vector<pv::data::decode::Annotation> annotations,
+void DecodeTrace::draw_annotations(
+		const vector<pv::data::decode::Annotation> &annotations,
 		QPainter &p, int h, const ViewItemPaintParams &pp, int y,
 		size_t base_colour, int row_title_width)
 {
 	using namespace pv::data::decode;
 
-	vector<Annotation> a_block;
+	auto block_begin = annotations.cbegin();
 	int p_end = INT_MIN;
 
 	double samples_per_pixel, pixels_offset;
 	tie(pixels_offset, samples_per_pixel) =
 		get_pixels_offset_samples_per_pixel();
 
-	// Sort the annotations by start sample so that decoders
-	// can't confuse us by creating annotations out of order
-	stable_sort(annotations.begin(), annotations.end(),
-		[](const Annotation &a, const Annotation &b) {
-			return a.start_sample() < b.start_sample(); });
-
-	// Gather all annotations that form a visual "block" and draw them as such
-	for (const Annotation &a : annotations) {
+	// The annotations come sorted by start sample. Gather all
+	// annotations that form a visual "block" and draw them as such
+	for (auto iter = annotations.cbegin(); iter != annotations.cend();
+			iter++) {
+		const Annotation &a = *iter;
 
 		const int a_start = a.start_sample() / samples_per_pixel - pixels_offset;
 		const int a_end = a.end_sample() / samples_per_pixel - pixels_offset;
@@ -425,33 +435,35 @@ void DecodeTrace::draw_annotations(vector<pv::data::decode::Annotation> annotati
 		// Were the previous and this annotation more than a pixel apart?
 		if ((abs(delta) > 1) || a_is_separate) {
 			// Block was broken, draw annotations that form the current block
-			if (a_block.size() == 1) {
-				draw_annotation(a_block.front(), p, h, pp, y, base_colour,
+			if (iter - block_begin == 1) {
+				draw_annotation(*block_begin, p, h, pp, y, base_colour,
 					row_title_width);
 			}
 			else
-				draw_annotation_block(a_block, p, h, y, base_colour);
+				draw_annotation_block(block_begin, iter, p, h, y,
+					base_colour);
 
-			a_block.clear();
+			block_begin = iter;
 		}
 
 		if (a_is_separate) {
 			draw_annotation(a, p, h, pp, y, base_colour, row_title_width);
 			// Next annotation must start a new block. delta will be > 1
 			// because we set p_end to INT_MIN but that's okay since
-			// a_block will be empty, so nothing will be drawn
+			// the block will be empty, so nothing will be drawn
+			block_begin = iter + 1;
 			p_end = INT_MIN;
 		} else {
-			a_block.push_back(a);
 			p_end = a_end;
 		}
 	}
 
-	if (a_block.size() == 1)
-		draw_annotation(a_block.front(), p, h, pp, y, base_colour,
+	if (annotations.cend() - block_begin == 1)
+		draw_annotation(*block_begin, p, h, pp, y, base_colour,
 			row_title_width);
 	else
-		draw_annotation_block(a_block, p, h, y, base_colour);
+		draw_annotation_block(block_begin, annotations.cend(), p, h, y,
+			base_colour);
 }
 
 void DecodeTrace::draw_annotation(const pv::data::decode::Annotation &a,
@@ -467,9 +479,10 @@ void DecodeTrace::draw_annotation(const pv::data::decode::Annotation &a,
 	const double end = a.end_sample() / samples_per_pixel -
 		pixels_offset;
 
+	// Merged annotations of different formats are drawn in gray
 	const size_t colour = (base_colour + a.format()) % countof(Colours);
-	p.setPen(OutlineColours[colour]);
-	p.setBrush(Colours[colour]);
+	p.setPen(a.format() < 0 ? QColor(Qt::gray) : OutlineColours[colour]);
+	p.setBrush(a.format() < 0 ? QColor(Qt::gray) : Colours[colour]);
 
 	if (start > pp.right() + DrawPadding || end < pp.left() - DrawPadding)
 		return;
@@ -482,41 +495,42 @@ void DecodeTrace::draw_annotation(const pv::data::decode::Annotation &a,
 }
 
 void DecodeTrace::draw_annotation_block(
-	vector<pv::data::decode::Annotation> annotations, QPainter &p, int h,
-	int y, size_t base_colour) const
+	vector<pv::data::decode::Annotation>::const_iterator begin,
+	vector<pv::data::decode::Annotation>::const_iterator end,
+	QPainter &p, int h, int y, size_t base_colour) const
 {
 	using namespace pv::data::decode;
 
-	if (annotations.empty())
+	if (begin == end)
 		return;
 
 	double samples_per_pixel, pixels_offset;
 	tie(pixels_offset, samples_per_pixel) =
 		get_pixels_offset_samples_per_pixel();
 
-	const double start = annotations.front().start_sample() /
+	const double start = begin->start_sample() /
 		samples_per_pixel - pixels_offset;
-	const double end = annotations.back().end_sample() /
+	const double stop = (end - 1)->end_sample() /
 		samples_per_pixel - pixels_offset;
 
 	const double top = y + .5 - h / 2;
 	const double bottom = y + .5 + h / 2;
 
-	const size_t colour = (base_colour + annotations.front().format()) %
+	const size_t colour = (base_colour + begin->format()) %
 		countof(Colours);
 
 	// Check if all annotations are of the same type (i.e. we can use one color)
-	// or if we should use a neutral color (i.e. gray)
-	const int format = annotations.front().format();
-	const bool single_format = std::all_of(
-		annotations.begin(), annotations.end(),
+	// or if we should use a neutral color (i.e. gray). Merged annotations
+	// of different types have a negative format.
+	const int format = begin->format();
+	const bool single_format = format >= 0 && std::all_of(begin, end,
 		[&](const Annotation &a) { return a.format() == format; });
 
 	p.setPen((single_format ? OutlineColours[colour] : Qt::gray));
 	p.setBrush(QBrush((single_format ? Colours[colour] : Qt::gray),
 		Qt::Dense4Pattern));
 	p.drawRoundedRect(
-		QRectF(start, top, end - start, bottom - top), h/4, h/4);
+		QRectF(start, top, stop - start, bottom - top), h/4, h/4);
 }
 
 void DecodeTrace::draw_instant(const pv::data::decode::Annotation &a, QPainter &p,
@@ -867,6 +881,16 @@ void DecodeTrace::create_decoder_form(int index,
 
 	bindings_.push_back(binding);
 
+	// Let the user pick between the native and the Python decoder
+	if (data::decode::NativeDecoder::available(decoder)) {
+		QCheckBox *const native = new QCheckBox(parent);
+		native->setChecked(dec->native());
+		native_mapper_.setMapping(native, index);
+		connect(native, SIGNAL(toggled(bool)),
+			&native_mapper_, SLOT(map()));
+		decoder_form->addRow(tr("Native decoder"), native);
+	}
+
 	form->addRow(group);
 	decoder_forms_.push_back(group);
 }
@@ -1036,5 +1060,23 @@ void DecodeTrace::on_show_hide_decoder(int index)
 		owner_->row_item_appearance_changed(false, true);
 }
 
+void DecodeTrace::on_native_decoder(int index)
+{
+	using pv::data::decode::Decoder;
+
+	const list< shared_ptr<Decoder> > stack(decoder_stack_->stack());
+
+	// Find the decoder in the stack
+	auto iter = stack.cbegin();
+	for (int i = 0; i < index; i++, iter++)
+		assert(iter != stack.end());
+
+	shared_ptr<Decoder> dec = *iter;
+	assert(dec);
+
+	dec->set_native(!dec->native());
+	decoder_stack_->begin_decode();
+}
+
 } // namespace view
 } // namespace pv
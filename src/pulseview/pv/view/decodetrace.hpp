@@ -133,7 +133,8 @@ public:
 	std::shared_ptr<pv::data::decode::Decoder> pv_decoder();
 
 private:
-	void draw_annotations(std::vector<pv::data::decode::Annotation> annotations,
+	void draw_annotations(
+		const std::vector<pv::data::decode::Annotation> &annotations,
 		QPainter &p, int h, const ViewItemPaintParams &pp, int y,
 		size_t base_colour, int row_title_width);
 
@@ -141,7 +142,9 @@ private:
 		int h, const ViewItemPaintParams &pp, int y,
 		size_t base_colour, int row_title_width) const;
 
-	void draw_annotation_block(std::vector<pv::data::decode::Annotation> annotations,
+	void draw_annotation_block(
+		std::vector<pv::data::decode::Annotation>::const_iterator begin,
+		std::vector<pv::data::decode::Annotation>::const_iterator end,
 		QPainter &p, int h, int y, size_t base_colour) const;
 
 	void draw_instant(const pv::data::decode::Annotation &a, QPainter &p,
@@ -204,6 +207,8 @@ private Q_SLOTS:
 
 	void on_show_hide_decoder(int index);
 
+	void on_native_decoder(int index);
+
 private:
 	pv::Session &session_;
 	std::shared_ptr<pv::data::DecoderStack> decoder_stack_;
@@ -222,7 +227,7 @@ private:
 
 	int min_useful_label_width_;
 
-	QSignalMapper delete_mapper_, show_hide_mapper_;
+	QSignalMapper delete_mapper_, show_hide_mapper_, native_mapper_;
 };
 
 } // namespace view
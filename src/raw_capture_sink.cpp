@@ -0,0 +1,271 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "raw_capture_sink.hpp"
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDebug>
+
+#include <algorithm>
+
+#include <gnuradio/io_signature.h>
+
+using namespace adiscope;
+
+raw_capture_sink::raw_capture_sink(unsigned int nb_channels,
+		size_t chunk_size, unsigned int nb_chunks) :
+	gr::sync_block("raw_capture_sink",
+			gr::io_signature::make(nb_channels, nb_channels,
+				sizeof(int16_t)),
+			gr::io_signature::make(0, 0, 0)),
+	d_nb_channels(nb_channels),
+	d_current(nullptr),
+	d_stop(false),
+	d_write_error(false),
+	d_recording(false),
+	d_written(0),
+	d_dropped(0)
+{
+	/* A chunk always holds whole sets of interleaved samples */
+	d_chunk_size = chunk_size - (chunk_size % nb_channels);
+
+	for (unsigned int i = 0; i < nb_chunks; i++) {
+		Chunk *chunk = new Chunk;
+
+		chunk->data.resize(d_chunk_size);
+		chunk->used = 0;
+		d_chunks.push_back(chunk);
+	}
+}
+
+raw_capture_sink::~raw_capture_sink()
+{
+	close();
+
+	for (auto chunk : d_chunks)
+		delete chunk;
+}
+
+bool raw_capture_sink::open(const QString& path, const CaptureInfo& info)
+{
+	close();
+
+	d_file.setFileName(path);
+	if (!d_file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+				QIODevice::Unbuffered)) {
+		qDebug() << "Cannot open capture file" << path << ":"
+			<< d_file.errorString();
+		return false;
+	}
+
+	d_info = info;
+	d_info.channels.resize(d_nb_channels);
+	writeHeader(0, 0);
+
+	d_free.assign(d_chunks.begin(), d_chunks.end());
+	d_full.clear();
+	d_current = d_free.front();
+	d_current->used = 0;
+	d_free.pop_front();
+
+	d_stop = false;
+	d_write_error = false;
+	d_written = 0;
+	d_dropped = 0;
+
+	d_thread = std::thread(&raw_capture_sink::writerThread, this);
+	d_recording = true;
+
+	return true;
+}
+
+/*
+ * Must only be called while the sink is not running, i.e. when it has been
+ * disconnected from the flowgraph or the flowgraph is locked.
+ */
+void raw_capture_sink::close()
+{
+	if (!d_file.isOpen())
+		return;
+
+	d_recording = false;
+
+	if (d_current && d_current->used)
+		queueCurrentChunk();
+
+	{
+		std::unique_lock<std::mutex> lock(d_mutex);
+		d_stop = true;
+	}
+	d_cond.notify_one();
+	d_thread.join();
+
+	/* Now that the totals are known, rewrite the header */
+	d_file.seek(0);
+	writeHeader(d_written, d_dropped);
+	d_file.close();
+
+	if (d_write_error)
+		qDebug() << "Capture file" << d_file.fileName()
+			<< "is incomplete";
+
+	d_current = nullptr;
+}
+
+bool raw_capture_sink::isOpen() const
+{
+	return d_file.isOpen();
+}
+
+quint64 raw_capture_sink::samplesWritten() const
+{
+	return d_written;
+}
+
+quint64 raw_capture_sink::samplesDropped() const
+{
+	return d_dropped;
+}
+
+void raw_capture_sink::writeHeader(quint64 nb_samples, quint64 nb_dropped)
+{
+	static const char magic[8] = { 'A', 'D', 'I', 'R', 'A', 'W', 0, 0 };
+	QByteArray header;
+	QDataStream stream(&header, QIODevice::WriteOnly);
+
+	stream.setByteOrder(QDataStream::LittleEndian);
+	stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+
+	quint32 header_size = 8 + 4 * sizeof(quint32) + 2 * sizeof(quint64)
+		+ 2 * sizeof(double)
+		+ d_nb_channels * (sizeof(quint32) + 4 * sizeof(double));
+
+	stream.writeRawData(magic, sizeof(magic));
+	stream << FORMAT_VERSION << header_size << (quint32)d_nb_channels
+		<< (quint32)sizeof(int16_t) << nb_samples << nb_dropped
+		<< d_info.sample_rate << d_info.filter_compensation;
+
+	for (const auto& chn : d_info.channels)
+		stream << chn.gain_mode << chn.hw_gain
+			<< chn.correction_gain << chn.correction_offset
+			<< chn.hw_offset;
+
+	d_file.write(header);
+}
+
+void raw_capture_sink::queueCurrentChunk()
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	d_full.push_back(d_current);
+
+	if (d_free.empty()) {
+		d_current = nullptr;
+	} else {
+		d_current = d_free.front();
+		d_current->used = 0;
+		d_free.pop_front();
+	}
+
+	lock.unlock();
+	d_cond.notify_one();
+}
+
+void raw_capture_sink::writerThread()
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	for (;;) {
+		d_cond.wait(lock, [this]{ return d_stop || !d_full.empty(); });
+
+		if (d_full.empty())
+			break;
+
+		Chunk *chunk = d_full.front();
+		d_full.pop_front();
+
+		/* Only the queues are protected; the disk I/O runs unlocked */
+		lock.unlock();
+
+		/* Only what reached the disk counts as written; after an
+		 * error the file is closed off at the last good chunk */
+		qint64 size = chunk->used * sizeof(int16_t);
+		quint64 nb_samples = chunk->used / d_nb_channels;
+
+		if (!d_write_error && d_file.write((const char *)
+					chunk->data.data(), size) != size)
+			d_write_error = true;
+
+		if (d_write_error)
+			d_dropped += nb_samples;
+		else
+			d_written += nb_samples;
+
+		lock.lock();
+		d_free.push_back(chunk);
+	}
+}
+
+int raw_capture_sink::work(int noutput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	if (!d_recording)
+		return noutput_items;
+
+	int done = 0;
+
+	while (done < noutput_items) {
+		if (!d_current) {
+			std::unique_lock<std::mutex> lock(d_mutex);
+
+			if (!d_free.empty()) {
+				d_current = d_free.front();
+				d_current->used = 0;
+				d_free.pop_front();
+			}
+		}
+
+		/* The writer thread is behind; drop what's left */
+		if (!d_current) {
+			d_dropped += noutput_items - done;
+			break;
+		}
+
+		int16_t *out = &d_current->data[d_current->used];
+		size_t room = (d_chunk_size - d_current->used) / d_nb_channels;
+		size_t count = std::min<size_t>(room, noutput_items - done);
+
+		for (unsigned int c = 0; c < d_nb_channels; c++) {
+			const int16_t *in = (const int16_t *)input_items[c] + done;
+
+			for (size_t i = 0; i < count; i++)
+				out[i * d_nb_channels + c] = in[i];
+		}
+
+		d_current->used += count * d_nb_channels;
+		done += count;
+
+		if (d_current->used == d_chunk_size)
+			queueCurrentChunk();
+	}
+
+	return noutput_items;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef RAW_CAPTURE_SINK_HPP
+#define RAW_CAPTURE_SINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QFile>
+#include <QString>
+
+#include <gnuradio/sync_block.h>
+
+namespace adiscope {
+
+	/*
+	 * Everything needed to convert the recorded raw samples to volts
+	 * offline. It is written at the beginning of the capture file.
+	 */
+	struct CaptureInfo {
+		struct Channel {
+			quint32 gain_mode;
+			double hw_gain;
+			double correction_gain;
+			double correction_offset;
+			double hw_offset;
+		};
+
+		double sample_rate;
+		double filter_compensation;
+		std::vector<Channel> channels;
+	};
+
+	/*
+	 * Records the raw int16 samples coming out of the device source to a
+	 * binary file. The samples of all the channels are interleaved into
+	 * large chunks that a dedicated thread writes to disk, so the flowgraph
+	 * never waits for the file system. If the disk can't keep up, the
+	 * samples that don't fit in any chunk are dropped and counted.
+	 *
+	 * File layout (little endian):
+	 *   char[8]  magic "ADIRAW\0\0"
+	 *   uint32   format version
+	 *   uint32   header size in bytes (offset of the first sample)
+	 *   uint32   number of channels
+	 *   uint32   sample size in bytes
+	 *   uint64   number of samples per channel in the file (filled in
+	 *            on close)
+	 *   uint64   number of samples per channel that were dropped or
+	 *            failed to be written
+	 *   double   sample rate
+	 *   double   filter compensation
+	 *   per channel:
+	 *     uint32 gain mode
+	 *     double hw gain, correction gain, correction offset, hw offset
+	 *   int16 samples, interleaved
+	 *
+	 * A sample converts to volts the same way adc_sample_conv does it:
+	 *   v = s * 0.78 / (2^11 * 1.3 * hw_gain) * correction_gain
+	 *       * filter_compensation - hw_offset
+	 */
+	class raw_capture_sink : public gr::sync_block
+	{
+	public:
+		typedef boost::shared_ptr<raw_capture_sink> sptr;
+
+		static const quint32 FORMAT_VERSION = 1;
+
+		explicit raw_capture_sink(unsigned int nb_channels,
+				size_t chunk_size = 1 << 20,
+				unsigned int nb_chunks = 16);
+		~raw_capture_sink();
+
+		bool open(const QString& path, const CaptureInfo& info);
+		void close();
+		bool isOpen() const;
+
+		quint64 samplesWritten() const;
+		quint64 samplesDropped() const;
+
+		int work(int noutput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		struct Chunk {
+			std::vector<int16_t> data;
+			size_t used;
+		};
+
+		void writerThread();
+		void writeHeader(quint64 nb_samples, quint64 nb_dropped);
+		void queueCurrentChunk();
+
+		unsigned int d_nb_channels;
+		size_t d_chunk_size;
+		CaptureInfo d_info;
+		QFile d_file;
+
+		std::vector<Chunk *> d_chunks;
+		std::deque<Chunk *> d_free;
+		std::deque<Chunk *> d_full;
+		Chunk *d_current;
+
+		std::mutex d_mutex;
+		std::condition_variable d_cond;
+		std::thread d_thread;
+		bool d_stop;
+		bool d_write_error;
+
+		std::atomic<bool> d_recording;
+		std::atomic<quint64> d_written;
+		std::atomic<quint64> d_dropped;
+	};
+}
+
+#endif /* RAW_CAPTURE_SINK_HPP */
@@ -50,6 +50,9 @@ namespace adiscope {
       virtual void set_nsamps(const int newsize) = 0;
       virtual void set_samp_rate(const double samp_rate) = 0;
 
+      /* Hand the samples to the plot as float instead of double */
+      virtual void set_float_frames(bool en) = 0;
+
       virtual void set_trigger_mode(trigger_mode mode, int channel,
 				    const std::string &tag_key="") = 0;
 
@@ -57,15 +57,14 @@ namespace adiscope {
                    io_signature::make(nconnections, nconnections, sizeof(float)),
                    io_signature::make(0, 0, 0)),
 	d_size(size), d_buffer_size(2*size), d_samp_rate(samp_rate), d_name(name),
-	d_nconnections(nconnections), d_index(0), d_start(0), d_end(size)
+	d_nconnections(nconnections), d_index(0), d_start(0), d_end(size),
+	d_float_frames(false)
     {
 
 
-      for(int n = 0; n < d_nconnections; n++) {
-	d_buffers.push_back((double*)volk_malloc(d_buffer_size*sizeof(double),
-                                                 volk_get_alignment()));
-	memset(d_buffers[n], 0, d_buffer_size*sizeof(double));
+      d_frames = FrameRing::sptr(new FrameRing(d_nconnections));
 
+      for(int n = 0; n < d_nconnections; n++) {
 	d_fbuffers.push_back((float*)volk_malloc(d_buffer_size*sizeof(float),
                                                   volk_get_alignment()));
 	memset(d_fbuffers[n], 0, d_buffer_size*sizeof(float));
@@ -95,7 +94,6 @@ namespace adiscope {
     scope_sink_f_impl::~scope_sink_f_impl()
     {
       for(int n = 0; n < d_nconnections; n++) {
-	volk_free(d_buffers[n]);
 	volk_free(d_fbuffers[n]);
       }
     }
@@ -158,11 +156,6 @@ namespace adiscope {
 
 	// Resize buffers and replace data
 	for(int n = 0; n < d_nconnections; n++) {
-	  volk_free(d_buffers[n]);
-	  d_buffers[n] = (double*)volk_malloc(d_buffer_size*sizeof(double),
-                                              volk_get_alignment());
-	  memset(d_buffers[n], 0, d_buffer_size*sizeof(double));
-
 	  volk_free(d_fbuffers[n]);
 	  d_fbuffers[n] = (float*)volk_malloc(d_buffer_size*sizeof(float),
                                                volk_get_alignment());
@@ -184,6 +177,13 @@ namespace adiscope {
 	      time_plot->setSampleRate(samp_rate, 1, "");
     }
 
+    void
+    scope_sink_f_impl::set_float_frames(bool en)
+    {
+      gr::thread::scoped_lock lock(d_setlock);
+      d_float_frames = en;
+    }
+
     int
     scope_sink_f_impl::nsamps() const
     {
@@ -303,18 +303,29 @@ namespace adiscope {
 
       // If we've have a full d_size of items in the buffers, plot.
       if((d_triggered) && (d_index == d_end) && d_end != 0) {
-        // Copy data to be plotted to start of buffers.
-        for(n = 0; n < d_nconnections; n++) {
-          //memmove(d_buffers[n], &d_buffers[n][d_start], d_size*sizeof(double));
-          volk_32f_convert_64f(d_buffers[n], &d_fbuffers[n][d_start], d_size);
-        }
 
         // Plot if we are able to update
         if(gr::high_res_timer_now() - d_last_time > d_update_time) {
           d_last_time = gr::high_res_timer_now();
+
+          // Convert the data to be plotted straight into the back frame
+          // of the ring; the plot picks it up without any further copy.
+          // Float frames skip the conversion altogether.
+          Frame *frame = d_frames->back(d_size, d_float_frames);
+          for(n = 0; n < d_nconnections; n++) {
+            if (d_float_frames)
+              memcpy(frame->fdata[n], &d_fbuffers[n][d_start],
+                     d_size * sizeof(float));
+            else
+              volk_32f_convert_64f(frame->data[n], &d_fbuffers[n][d_start], d_size);
+            d_frames->fillEnvelope(frame, n, &d_fbuffers[n][d_start]);
+            frame->tags[n] = d_tags[n];
+          }
+          d_frames->publish();
+
           if (d_qApplication)
 		d_qApplication->postEvent(this->plot,
-				    new IdentifiableTimeUpdateEvent(d_buffers, d_size, d_tags, d_name));
+				    new FrameUpdateEvent(d_frames, d_name));
 	}
 
         // We've plotting, so reset the state
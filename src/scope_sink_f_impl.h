@@ -28,6 +28,7 @@
 #include "scope_sink_f.h"
 #include "TimeDomainDisplayPlot.h"
 #include "FftDisplayPlot.h"
+#include "frame_ring.hpp"
 
 namespace adiscope {
 
@@ -43,7 +44,8 @@ namespace adiscope {
 
       int d_index, d_start, d_end;
       std::vector<float*> d_fbuffers;
-      std::vector<double*> d_buffers;
+      FrameRing::sptr d_frames;
+      bool d_float_frames;
       std::vector< std::vector<gr::tag_t> > d_tags;
 
       QObject *plot;
@@ -76,6 +78,7 @@ namespace adiscope {
       void set_update_time(double t);
       void set_nsamps(const int size);
       void set_samp_rate(const double samp_rate);
+      void set_float_frames(bool en);
       void set_trigger_mode(trigger_mode mode, int channel,
 			    const std::string &tag_key="");
 
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "single_bin_dft.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <gnuradio/io_signature.h>
+
+using namespace adiscope;
+
+single_bin_dft::single_bin_dft() :
+	QObject(),
+	gr::sync_block("single_bin_dft",
+			gr::io_signature::make(NB_CHANNELS, NB_CHANNELS,
+				sizeof(short)),
+			gr::io_signature::make(0, 0, 0)),
+	d_tag_key(pmt::intern("buffer_start")),
+	d_armed(false),
+	d_has_start(false),
+	d_skip(0),
+	d_buffer_size(0),
+	d_start(0),
+	d_omega(0.0),
+	d_cos(TABLE_SIZE),
+	d_sin(TABLE_SIZE),
+	d_pos(0),
+	d_block(0)
+{
+}
+
+single_bin_dft::~single_bin_dft()
+{
+}
+
+void single_bin_dft::arm(double frequency, double sample_rate,
+		size_t buffer_size, unsigned int skip)
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	d_omega = 2.0 * M_PI * frequency / sample_rate;
+	for (size_t i = 0; i < TABLE_SIZE; i++) {
+		d_cos[i] = std::cos(d_omega * i);
+		d_sin[i] = -std::sin(d_omega * i);
+	}
+
+	d_buffer_size = buffer_size;
+	d_skip = skip;
+	d_has_start = false;
+	d_armed = true;
+}
+
+void single_bin_dft::disarm()
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	d_armed = false;
+}
+
+void single_bin_dft::accumulate(gr_vector_const_void_star &input_items,
+		size_t offset, size_t count)
+{
+	while (count) {
+		size_t idx = d_pos % TABLE_SIZE;
+		size_t len = std::min(count, TABLE_SIZE - idx);
+		const float *cos_tbl = &d_cos[idx];
+		const float *sin_tbl = &d_sin[idx];
+
+		for (unsigned int c = 0; c < NB_CHANNELS; c++) {
+			const short *in = (const short *) input_items[c]
+				+ offset;
+			float re = 0.0f, im = 0.0f;
+
+			for (size_t k = 0; k < len; k++) {
+				re += in[k] * cos_tbl[k];
+				im += in[k] * sin_tbl[k];
+			}
+
+			d_acc_re[c] += re;
+			d_acc_im[c] += im;
+		}
+
+		d_pos += len;
+		offset += len;
+		count -= len;
+
+		if (d_pos % TABLE_SIZE == 0)
+			fold();
+	}
+}
+
+void single_bin_dft::fold()
+{
+	std::complex<double> phasor = std::polar(1.0,
+			-d_omega * (double) (d_block * TABLE_SIZE));
+
+	for (unsigned int c = 0; c < NB_CHANNELS; c++) {
+		d_sum[c] += std::complex<double>(d_acc_re[c], d_acc_im[c])
+			* phasor;
+		d_acc_re[c] = 0.0f;
+		d_acc_im[c] = 0.0f;
+	}
+
+	d_block++;
+}
+
+int single_bin_dft::work(int noutput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	if (!d_armed)
+		return noutput_items;
+
+	uint64_t start = nitems_read(0);
+	uint64_t end = start + noutput_items;
+
+	if (!d_has_start) {
+		std::vector<gr::tag_t> tags;
+
+		get_tags_in_range(tags, 0, start, end, d_tag_key);
+		std::sort(tags.begin(), tags.end(), gr::tag_t::offset_compare);
+
+		for (const auto& tag : tags) {
+			if (d_skip) {
+				d_skip--;
+				continue;
+			}
+
+			d_start = tag.offset;
+			d_has_start = true;
+			d_pos = 0;
+			d_block = 0;
+
+			for (unsigned int c = 0; c < NB_CHANNELS; c++) {
+				d_acc_re[c] = 0.0f;
+				d_acc_im[c] = 0.0f;
+				d_sum[c] = 0.0;
+			}
+			break;
+		}
+
+		if (!d_has_start)
+			return noutput_items;
+	}
+
+	uint64_t from = std::max(start, d_start);
+	uint64_t to = std::min(end, d_start + d_buffer_size);
+
+	if (from < to)
+		accumulate(input_items, from - start, to - from);
+
+	if (d_pos < d_buffer_size)
+		return noutput_items;
+
+	if (d_pos % TABLE_SIZE)
+		fold();
+
+	std::complex<double> x0 = d_sum[0] * (2.0 / d_buffer_size);
+	std::complex<double> x1 = d_sum[1] * (2.0 / d_buffer_size);
+	std::vector<float> values;
+
+	values.push_back(std::norm(x0));
+	values.push_back(std::norm(x1));
+	values.push_back(std::arg(x0 * std::conj(x1)));
+
+	d_armed = false;
+	lock.unlock();
+
+	Q_EMIT sampled(values);
+
+	return noutput_items;
+}
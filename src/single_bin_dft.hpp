@@ -0,0 +1,92 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SINGLE_BIN_DFT_HPP
+#define SINGLE_BIN_DFT_HPP
+
+#include <complex>
+#include <mutex>
+#include <vector>
+
+#include <QObject>
+
+#include <gnuradio/sync_block.h>
+
+namespace adiscope {
+	/*
+	 * Computes the DFT of two raw ADC streams at a single frequency,
+	 * over one complete acquisition buffer per sweep step. The buffers
+	 * are delimited by the "buffer_start" tags of the IIO source; the
+	 * samples outside of the selected buffer are not processed at all.
+	 *
+	 * The result is the squared magnitude of both channels, scaled like
+	 * the amplitude of a sine wave, and the phase of the first channel
+	 * relative to the second one.
+	 */
+	class single_bin_dft : public QObject, public gr::sync_block
+	{
+		Q_OBJECT
+
+	public:
+		explicit single_bin_dft();
+		~single_bin_dft();
+
+		/* Analyze the next buffer of buffer_size samples, after
+		 * letting the first 'skip' buffers go by */
+		void arm(double frequency, double sample_rate,
+				size_t buffer_size, unsigned int skip);
+		void disarm();
+
+		int work(int noutput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	Q_SIGNALS:
+		void sampled(const std::vector<float> values);
+
+	private:
+		static const unsigned int NB_CHANNELS = 2;
+		static const size_t TABLE_SIZE = 1024;
+
+		void accumulate(gr_vector_const_void_star &input_items,
+				size_t offset, size_t count);
+		void fold();
+
+		std::mutex d_mutex;
+		pmt::pmt_t d_tag_key;
+
+		bool d_armed;
+		bool d_has_start;
+		unsigned int d_skip;
+		size_t d_buffer_size;
+		uint64_t d_start;
+
+		/* e^(-jwn) for one block of samples; the blocks are then
+		 * combined with the phase they start at */
+		double d_omega;
+		std::vector<float> d_cos, d_sin;
+
+		size_t d_pos;
+		uint64_t d_block;
+		float d_acc_re[NB_CHANNELS], d_acc_im[NB_CHANNELS];
+		std::complex<double> d_sum[NB_CHANNELS];
+	};
+}
+
+#endif /* SINGLE_BIN_DFT_HPP */
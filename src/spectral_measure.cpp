@@ -0,0 +1,244 @@
+/*
+ * Copyright 2017 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "spectral_measure.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include <volk/volk.h>
+
+using namespace adiscope;
+
+SpectralMeasure::SpectralMeasure() :
+	m_enbw(1.0),
+	m_lobe(1),
+	m_harmonic_count(5),
+	m_band_first(1),
+	m_band_last(0)
+{
+	m_results.valid = false;
+}
+
+void SpectralMeasure::setWindow(const std::vector<float>& window,
+	unsigned int lobe_bins)
+{
+	double sum = 0, sum_sq = 0;
+
+	for (float w : window) {
+		sum += w;
+		sum_sq += w * w;
+	}
+
+	/* In bins: N * sum(w^2) / sum(w)^2 */
+	if (sum > 0)
+		m_enbw = window.size() * sum_sq / (sum * sum);
+
+	m_lobe = std::max(lobe_bins, 1u);
+}
+
+void SpectralMeasure::setHarmonicCount(unsigned int count)
+{
+	m_harmonic_count = count;
+}
+
+unsigned int SpectralMeasure::harmonicCount() const
+{
+	return m_harmonic_count;
+}
+
+void SpectralMeasure::setBand(unsigned int first, unsigned int last)
+{
+	m_band_first = first;
+	m_band_last = last;
+}
+
+const SpectralMeasurements& SpectralMeasure::results() const
+{
+	return m_results;
+}
+
+void SpectralMeasure::invalidate()
+{
+	m_results.valid = false;
+}
+
+float SpectralMeasure::sum(const float *power, unsigned int first,
+	unsigned int last) const
+{
+	float result = 0;
+
+	if (first <= last)
+		volk_32f_accumulator_s32f(&result, power + first,
+			last - first + 1);
+
+	return result;
+}
+
+bool SpectralMeasure::overlaps(unsigned int first, unsigned int last) const
+{
+	for (const Range& r : m_excluded)
+		if (first <= r.last && last >= r.first)
+			return true;
+
+	return false;
+}
+
+void SpectralMeasure::exclude(unsigned int first, unsigned int last)
+{
+	Range r = { first, last };
+
+	m_excluded.push_back(r);
+}
+
+void SpectralMeasure::measure(const float *power, unsigned int num_bins,
+	float full_scale)
+{
+	SpectralMeasurements& res = m_results;
+	unsigned int L = m_lobe;
+
+	res.valid = false;
+	res.harmonics.clear();
+	m_excluded.clear();
+
+	if (num_bins < 4 * L + 4)
+		return;
+
+	/* DC */
+	exclude(0, L);
+
+	/* Fundamental */
+	uint32_t k0;
+	volk_32f_index_max_32u(&k0, power + L + 1, num_bins - L - 1);
+	k0 += L + 1;
+
+	unsigned int fund_first = k0 - std::min(k0, L);
+	unsigned int fund_last = std::min(k0 + L, num_bins - 1);
+
+	fund_first = std::max(fund_first, L + 1);
+
+	float fund = sum(power, fund_first, fund_last);
+	if (!(fund > 0))
+		return;
+
+	exclude(fund_first, fund_last);
+
+	/* Harmonics, folded back into the first Nyquist zone */
+	unsigned int fft_size = 2 * num_bins;
+	float harmonics = 0;
+
+	for (unsigned int h = 2; h < m_harmonic_count + 2; h++) {
+		unsigned int bin = ((uint64_t)h * k0) % fft_size;
+
+		if (bin >= num_bins)
+			bin = fft_size - bin;
+		if (bin >= num_bins)
+			bin = num_bins - 1;
+
+		/* Pick the top of the lobe, which leakage may have moved */
+		unsigned int first = bin - std::min(bin, L);
+		unsigned int last = std::min(bin + L, num_bins - 1);
+		uint32_t top;
+
+		volk_32f_index_max_32u(&top, power + first, last - first + 1);
+		top += first;
+
+		first = top - std::min(top, L);
+		last = std::min(top + L, num_bins - 1);
+
+		/* Lands on DC, the fundamental or a previous harmonic */
+		if (overlaps(first, last)) {
+			res.harmonics.push_back(
+				-std::numeric_limits<double>::infinity());
+			continue;
+		}
+
+		float p = sum(power, first, last);
+
+		harmonics += p;
+		res.harmonics.push_back(10 * log10(p / m_enbw) - full_scale);
+		exclude(first, last);
+	}
+
+	/* Noise: the sum of the gaps between the excluded ranges */
+	std::sort(m_excluded.begin(), m_excluded.end(),
+		[](const Range& a, const Range& b) {
+			return a.first < b.first;
+		});
+
+	float noise = 0;
+	unsigned int noise_bins = 0;
+	unsigned int next = 0;
+
+	for (const Range& r : m_excluded) {
+		if (r.first > next) {
+			noise += sum(power, next, r.first - 1);
+			noise_bins += r.first - next;
+		}
+		next = std::max(next, r.last + 1);
+	}
+
+	if (next < num_bins) {
+		noise += sum(power, next, num_bins - 1);
+		noise_bins += num_bins - next;
+	}
+
+	if (!noise_bins)
+		return;
+
+	double noise_per_bin = noise / noise_bins;
+	double total_noise = noise_per_bin * (num_bins - (L + 1));
+
+	/* Largest spur: highest bin besides DC and the fundamental */
+	float spur = 0;
+	uint32_t idx;
+
+	if (fund_first > L + 1) {
+		volk_32f_index_max_32u(&idx, power + L + 1,
+			fund_first - L - 1);
+		spur = std::max(spur, power[L + 1 + idx]);
+	}
+	if (fund_last + 1 < num_bins) {
+		volk_32f_index_max_32u(&idx, power + fund_last + 1,
+			num_bins - fund_last - 1);
+		spur = std::max(spur, power[fund_last + 1 + idx]);
+	}
+
+	res.fundamental_bin = k0;
+	res.fundamental = 10 * log10(fund / m_enbw) - full_scale;
+	res.thd = 10 * log10(harmonics / fund);
+	res.snr = 10 * log10(fund / total_noise);
+	res.sinad = 10 * log10(fund / (total_noise + harmonics));
+	res.sfdr = 10 * log10(power[k0] / spur);
+	res.enob = (res.sinad - 1.76) / 6.02;
+	res.noise_floor = 10 * log10(noise_per_bin) - full_scale;
+
+	if (m_band_first <= m_band_last && m_band_first < num_bins) {
+		float band = sum(power, m_band_first,
+			std::min(m_band_last, num_bins - 1));
+
+		res.band_power = 10 * log10(band / m_enbw) - full_scale;
+	} else {
+		res.band_power = std::numeric_limits<double>::quiet_NaN();
+	}
+
+	res.valid = true;
+}
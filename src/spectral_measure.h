@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef SPECTRAL_MEASURE_H
+#define SPECTRAL_MEASURE_H
+
+#include <vector>
+
+namespace adiscope {
+
+struct SpectralMeasurements {
+	bool valid;
+	unsigned int fundamental_bin;
+	double fundamental;		/* dBFS */
+	std::vector<double> harmonics;	/* dBFS, from the 2nd one on */
+	double thd;			/* dBc */
+	double snr;			/* dB */
+	double sinad;			/* dB */
+	double sfdr;			/* dBc */
+	double enob;			/* bits */
+	double noise_floor;		/* dBFS per bin */
+	double band_power;		/* dBFS, NaN if no band is set */
+};
+
+/*
+ * Single-tone measurements on a power spectrum, on the same dBFS scale as
+ * the plot. The fundamental is the highest bin above DC, and its harmonics
+ * are searched around their (possibly aliased) frequencies.
+ *
+ * The power of a tone is the sum of the bins of its window main lobe,
+ * divided by the equivalent noise bandwidth of the window. Everything that
+ * is not DC, the fundamental or a harmonic is noise. The noise in the bins
+ * that were left out is estimated from the average of the other bins.
+ */
+class SpectralMeasure {
+public:
+	SpectralMeasure();
+
+	/* lobe_bins is the half width of the main lobe of the window */
+	void setWindow(const std::vector<float>& window,
+		unsigned int lobe_bins);
+	void setHarmonicCount(unsigned int count);
+	unsigned int harmonicCount() const;
+
+	/* Bins [first, last] of the band power; an empty range disables it */
+	void setBand(unsigned int first, unsigned int last);
+
+	/* Linear power of the bins from DC to Nyquist */
+	void measure(const float *power, unsigned int num_bins,
+		float full_scale);
+	const SpectralMeasurements& results() const;
+
+	/* Marks the results as out of date, e.g. when a frame isn't measured */
+	void invalidate();
+
+private:
+	struct Range {
+		unsigned int first, last;	/* Inclusive */
+	};
+
+	float sum(const float *power, unsigned int first,
+		unsigned int last) const;
+	bool overlaps(unsigned int first, unsigned int last) const;
+	void exclude(unsigned int first, unsigned int last);
+
+	double m_enbw;
+	unsigned int m_lobe;
+	unsigned int m_harmonic_count;
+	unsigned int m_band_first, m_band_last;
+
+	std::vector<Range> m_excluded;
+	SpectralMeasurements m_results;
+};
+}
+
+#endif /* SPECTRAL_MEASURE_H */
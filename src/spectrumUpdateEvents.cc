@@ -277,6 +277,34 @@ IdentifiableTimeUpdateEvent::IdentifiableTimeUpdateEvent(const std::vector<doubl
 /***************************************************************************/
 
 
+FrameUpdateEvent::FrameUpdateEvent(adiscope::FrameRing::sptr frames,
+				   const std::string senderName)
+  : QEvent(QEvent::Type(FrameUpdateEventType)),
+    _frames(frames),
+    _senderName(senderName)
+{
+}
+
+FrameUpdateEvent::~FrameUpdateEvent()
+{
+}
+
+adiscope::FrameRing::sptr
+FrameUpdateEvent::frames() const
+{
+  return _frames;
+}
+
+std::string
+FrameUpdateEvent::senderName() const
+{
+  return _senderName;
+}
+
+
+/***************************************************************************/
+
+
 FreqUpdateEvent::FreqUpdateEvent(const std::vector<double*> dataPoints,
 				 const uint64_t numDataPoints)
   : QEvent(QEvent::Type(SpectrumUpdateEventType))
@@ -31,10 +31,13 @@
 #include <gnuradio/high_res_timer.h>
 #include <gnuradio/tags.h>
 
+#include "frame_ring.hpp"
+
 static const int SpectrumUpdateEventType = 10005;
 static const int SpectrumWindowCaptionEventType = 10008;
 static const int SpectrumWindowResetEventType = 10009;
 static const int SpectrumFrequencyRangeEventType = 10010;
+static const int FrameUpdateEventType = 10011;
 
 class SpectrumUpdateEvent:public QEvent{
 
@@ -172,6 +175,29 @@ private:
 /********************************************************************/
 
 
+class FrameUpdateEvent: public QEvent
+{
+public:
+  FrameUpdateEvent(adiscope::FrameRing::sptr frames,
+		   const std::string senderName);
+
+  ~FrameUpdateEvent();
+
+  adiscope::FrameRing::sptr frames() const;
+  std::string senderName() const;
+
+  static QEvent::Type Type()
+      { return QEvent::Type(FrameUpdateEventType); }
+
+private:
+  adiscope::FrameRing::sptr _frames;
+  std::string _senderName;
+};
+
+
+/********************************************************************/
+
+
 class FreqUpdateEvent: public QEvent
 {
 public:
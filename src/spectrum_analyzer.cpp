@@ -19,11 +19,11 @@
 
 /* GNU Radio includes */
 #include <gnuradio/blocks/float_to_complex.h>
-#include <gnuradio/blocks/complex_to_mag_squared.h>
 #include <gnuradio/blocks/add_ff.h>
 #include <gnuradio/iio/math.h>
 #include <gnuradio/analog/sig_source_f.h>
 #include <gnuradio/analog/fastnoise_source_f.h>
+#include <gnuradio/filter/firdes.h>
 
 /* Qt includes */
 #include <QGridLayout>
@@ -36,6 +36,7 @@
 #include "filter.hpp"
 #include "math.hpp"
 #include "fft_block.hpp"
+#include "frame_trim.hpp"
 #include "adc_sample_conv.hpp"
 #include "dynamicWidget.hpp"
 #include "hardware_trigger.hpp"
@@ -46,11 +47,19 @@
 
 #include <boost/make_shared.hpp>
 #include <iio.h>
+#include <cmath>
 #include <iostream>
+#include <thread>
 
 using namespace adiscope;
 using namespace std;
 
+const unsigned long SpectrumAnalyzer::WELCH_BUFFER_SIZE;
+constexpr double SpectrumAnalyzer::WELCH_UPDATE_PERIOD;
+const unsigned long SpectrumAnalyzer::ZOOM_MAX_BUFFER_SIZE;
+constexpr double SpectrumAnalyzer::ZOOM_USABLE_BANDWIDTH;
+const unsigned int SpectrumAnalyzer::WATERFALL_ROWS;
+
 std::vector<std::pair<QString, FftDisplayPlot::AverageType>>
 SpectrumAnalyzer::avg_types = {
 	{"Sample", FftDisplayPlot::SAMPLE},
@@ -90,7 +99,13 @@ SpectrumAnalyzer::SpectrumAnalyzer(struct iio_context *ctx, Filter *filt,
 	crt_marker(-1),
 	max_peak_count(10),
 	fft_size(32768),
-	bin_sizes({256, 512, 1024, 2048, 4096, 8192, 16384, 32768})
+	bin_sizes({256, 512, 1024, 2048, 4096, 8192, 16384, 32768}),
+	welch_enabled(false),
+	welch_overlap(0.5),
+	zoom_enabled(false),
+	zoom_decimation(1),
+	waterfall_enabled(false),
+	waterfall(nullptr)
 {
 
 	// Get the list of names of the available channels
@@ -161,6 +176,12 @@ SpectrumAnalyzer::SpectrumAnalyzer(struct iio_context *ctx, Filter *filt,
 		(ui->widgetPlotContainer->layout());
 	gLayout->addWidget(fft_plot, 1, 0, 1, 1);
 
+	waterfall_buffer = boost::make_shared<WaterfallBuffer>(1,
+			WATERFALL_ROWS);
+	waterfall = new WaterfallDisplay(waterfall_buffer, this);
+	waterfall->hide();
+	gLayout->addWidget(waterfall, 3, 0, 1, 1);
+
 	// Initialize spectrum channels
 	for (int i = 0 ; i < num_adc_channels; i++) {
 		channel_sptr channel = boost::make_shared<SpectrumChannel>(i,
@@ -350,8 +371,8 @@ void SpectrumAnalyzer::runStopToggled(bool checked)
 			writeAllSettingsToHardware();
 		}
 
-		fft_plot->presetSampleRate(sample_rate);
-		fft_sink->set_samp_rate(sample_rate);
+		fft_plot->presetSampleRate(sample_rate / zoom_decimation);
+		fft_sink->set_samp_rate(sample_rate / zoom_decimation);
 		start_blockchain_flow();
 	} else {
 		stop_blockchain_flow();
@@ -367,6 +388,7 @@ void SpectrumAnalyzer::build_gnuradio_block_chain()
 	fft_sink = adiscope::scope_sink_f::make(fft_size, 100e6,
 			"Osc Frequency", num_adc_channels,
 			(QObject *)fft_plot);
+	fft_sink->set_float_frames(true);
 	fft_sink->set_trigger_mode(TRIG_MODE_TAG, 0, "buffer_start");
 
 	bool started = iio->started();
@@ -392,37 +414,303 @@ void SpectrumAnalyzer::build_gnuradio_block_chain()
 
 	fft_ids = new iio_manager::port_id[num_adc_channels];
 
-	for (int i = 0; i < num_adc_channels; i++) {
-		auto fft = gnuradio::get_initial_sptr(
-				new fft_block(false, fft_size));
-		auto ctm = gr::blocks::complex_to_mag_squared::make(1);
+	for (int i = 0; i < num_adc_channels; i++)
+		connect_channel_chain(i);
 
-		// iio(i)->fft->ctm->fft_sink
-		fft_ids[i] = iio->connect(fft, i, 0, true, fft_size);
-		iio->connect(fft, 0, ctm, 0);
-		iio->connect(ctm, 0, fft_sink, i);
+	if (started)
+		iio->unlock();
+}
 
-		channels[i]->fft_block = fft;
-		channels[i]->ctm_block = ctm;
+/* Must be called with the iio_manager locked */
+void SpectrumAnalyzer::connect_channel_chain(int chIdx)
+{
+	auto channel = channels[chIdx];
+
+	if (welch_enabled) {
+		auto welch = gnuradio::get_initial_sptr(
+				new welch_psd(fft_size, welch_overlap,
+					welchAverages()));
+
+		// iio(i)->welch->fft_sink
+		fft_ids[chIdx] = iio->connect(welch, chIdx, 0, true,
+				std::max<unsigned long>(fft_size,
+					WELCH_BUFFER_SIZE));
+		iio->connect(welch, 0, fft_sink, chIdx);
+
+		channel->welch_block = welch;
+		channel->fft_block.reset();
+		shared_fft.reset();
+		channel->ddc_block.reset();
+	} else if (zoom_decimation > 1) {
+		double center = ui->center_freq->value() / sample_rate;
+		auto taps = zoom_filter_taps(zoom_decimation);
+		size_t settle = zoom_settle_length(taps, zoom_decimation);
+
+		// The sampling frequency is normalized, so that the center
+		// frequency can follow sample rate changes
+		auto ddc = gr::filter::freq_xlating_fir_filter_fcc::make(
+				zoom_decimation, taps, center, 1.0);
+		auto trim = gnuradio::get_initial_sptr(
+				new frame_trim(sizeof(gr_complex), fft_size,
+					settle));
+		auto fft = channel_fft_block(chIdx, true);
+
+		// The buffers aren't contiguous, so the first outputs of the
+		// filter, which still see the end of the previous buffer, are
+		// acquired in excess and dropped.
+		// iio(i)->ddc->trim->fft(i)->fft_sink
+		fft_ids[chIdx] = iio->connect(ddc, chIdx, 0, true,
+				zoom_decimation * (fft_size + settle));
+		iio->connect(ddc, 0, trim, 0);
+		iio->connect(trim, 0, fft, chIdx);
+		iio->connect(fft, chIdx, fft_sink, chIdx);
+
+		channel->ddc_block = ddc;
+		channel->fft_block = fft;
+		channel->welch_block.reset();
+	} else {
+		auto fft = channel_fft_block(chIdx, false);
+
+		// iio(i)->fft(i)->fft_sink
+		fft_ids[chIdx] = iio->connect(fft, chIdx, chIdx, true,
+				fft_size);
+		iio->connect(fft, chIdx, fft_sink, chIdx);
+
+		channel->fft_block = fft;
+		channel->welch_block.reset();
+		channel->ddc_block.reset();
+	}
+
+	if (waterfall_enabled) {
+		// The waterfall taps the spectrum of every channel and shows
+		// the selected one
+		if (chIdx == 0) {
+			waterfall_blk = gnuradio::get_initial_sptr(
+					new waterfall_sink(num_adc_channels,
+						fft_size, waterfall_buffer));
+			waterfall_blk->set_channel(crt_channel_id);
+			waterfall_blk->set_full_spectrum(zoom_decimation > 1);
+		}
+
+		if (channel->welch_block)
+			iio->connect(channel->welch_block, 0,
+					waterfall_blk, chIdx);
+		else
+			iio->connect(channel->fft_block, chIdx,
+					waterfall_blk, chIdx);
+	}
+
+	channel->setFftWindow(channel->fftWindow(), fft_size);
+}
+
+/*
+ * All the channels go through the same FFT block, so that their frames are
+ * transformed in parallel. It is created along with the first channel.
+ */
+boost::shared_ptr<adiscope::fft_block> SpectrumAnalyzer::channel_fft_block(
+		int chIdx, bool use_complex)
+{
+	if (chIdx == 0)
+		shared_fft = gnuradio::get_initial_sptr(
+				new fft_block(use_complex, fft_size,
+					num_adc_channels,
+					std::thread::hardware_concurrency()));
+
+	return shared_fft;
+}
+
+void SpectrumAnalyzer::rebuild_channel_chains()
+{
+	// TO DO: This is cumbersome. We shouldn't have to rebuild the entire
+	//        block chain every time we need to change the FFT size. A
+	//        spectrum_sink block similar to scope_sink_f would be better
+
+	bool started = iio->started();
+	bool running = fft_ids[0]->enabled();
+
+	if (started)
+		iio->lock();
+
+	// All the chains end in the same sink, so they all go away together
+	for (int i = 0; i < num_adc_channels; i++)
+		iio->disconnect(fft_ids[i]);
+
+	for (int i = 0; i < num_adc_channels; i++) {
+		connect_channel_chain(i);
+
+		if (running)
+			iio->start(fft_ids[i]);
 	}
 
 	if (started)
 		iio->unlock();
 }
 
+unsigned int SpectrumAnalyzer::welchAverages() const
+{
+	double hop = fft_size * (1.0 - welch_overlap);
+
+	return std::max(1.0, sample_rate * WELCH_UPDATE_PERIOD / hop);
+}
+
+void SpectrumAnalyzer::setWelch(bool en)
+{
+	if (en == welch_enabled)
+		return;
+
+	welch_enabled = en;
+	zoom_decimation = zoomDecimation(fft_size);
+
+	if (iio)
+		rebuild_channel_chains();
+
+	updateZoom();
+}
+
+/*
+ * Flat up to the usable bandwidth and stopped at the Nyquist frequency of
+ * the decimated signal. The gain of 2 keeps the level of a real sine wave,
+ * half of which is filtered out.
+ */
+std::vector<float> SpectrumAnalyzer::zoom_filter_taps(unsigned int decim)
+{
+	return gr::filter::firdes::low_pass(2.0, 1.0,
+			(ZOOM_USABLE_BANDWIDTH + 1.0) / 4.0 / decim,
+			(1.0 - ZOOM_USABLE_BANDWIDTH) / 2.0 / decim);
+}
+
+/* Number of decimated samples that still depend on the filter history */
+size_t SpectrumAnalyzer::zoom_settle_length(const std::vector<float>& taps,
+		unsigned int decim)
+{
+	return (taps.size() + decim - 1) / decim;
+}
+
+unsigned int SpectrumAnalyzer::zoomDecimation(uint fft_size) const
+{
+	double span = ui->span_freq->value();
+
+	if (!zoom_enabled || welch_enabled || !iio || span <= 0)
+		return 1;
+
+	double decim = ZOOM_USABLE_BANDWIDTH * sample_rate / span;
+
+	// The acquisition buffer holds all the samples of one FFT, plus
+	// those the filter needs to settle. Their decimated count hardly
+	// depends on the decimation, so the one of the largest decimation
+	// bounds it, give or take one sample of rounding.
+	unsigned int max_decim = std::max(1ul,
+			ZOOM_MAX_BUFFER_SIZE / fft_size);
+	size_t settle = zoom_settle_length(zoom_filter_taps(max_decim),
+			max_decim) + 1;
+
+	decim = std::min(decim,
+			(double)(ZOOM_MAX_BUFFER_SIZE / (fft_size + settle)));
+
+	return std::max(1.0, std::floor(decim));
+}
+
+void SpectrumAnalyzer::updateZoom()
+{
+	unsigned int decim = zoomDecimation(fft_size);
+	double center = ui->center_freq->value();
+
+	if (decim != zoom_decimation) {
+		zoom_decimation = decim;
+		rebuild_channel_chains();
+		fft_plot->resetAverageHistory();
+	} else {
+		for (int i = 0; i < channels.size(); i++)
+			if (channels[i]->ddc_block)
+				channels[i]->ddc_block->set_center_freq(
+					center / sample_rate);
+	}
+
+	fft_plot->presetZoom(zoom_decimation > 1, center);
+	fft_plot->presetSampleRate(sample_rate / zoom_decimation);
+	fft_sink->set_samp_rate(sample_rate / zoom_decimation);
+
+	if (waterfall_blk)
+		waterfall_blk->set_full_spectrum(zoom_decimation > 1);
+	updateWaterfallRange();
+}
+
+void SpectrumAnalyzer::setWaterfall(bool en)
+{
+	if (en == waterfall_enabled || !iio)
+		return;
+
+	waterfall_enabled = en;
+	rebuild_channel_chains();
+
+	if (!en)
+		waterfall_blk.reset();
+
+	waterfall_buffer->clear();
+	updateWaterfallRange();
+	waterfall->setVisible(en);
+}
+
+/* Shows the same frequencies as the plot, with the same dB scale */
+void SpectrumAnalyzer::updateWaterfallRange()
+{
+	double start = ui->start_freq->value();
+	double stop = ui->stop_freq->value();
+	double data_start = 0;
+	double data_stop = sample_rate / 2;
+
+	if (zoom_decimation > 1) {
+		double center = ui->center_freq->value();
+		double half_band = sample_rate / zoom_decimation / 2;
+
+		data_start = center - half_band;
+		data_stop = center + half_band;
+	}
+
+	double range = data_stop - data_start;
+	if (range > 0)
+		waterfall->setVisibleRange((start - data_start) / range,
+				(stop - data_start) / range);
+
+	QwtScaleDiv scale = fft_plot->axisScaleDiv(QwtPlot::yLeft);
+	waterfall_buffer->setRange(scale.lowerBound(), scale.upperBound());
+}
+
+void SpectrumAnalyzer::setZoom(bool en)
+{
+	if (en == zoom_enabled)
+		return;
+
+	zoom_enabled = en;
+	updateZoom();
+}
+
+void SpectrumAnalyzer::setWelchOverlap(float overlap)
+{
+	welch_overlap = std::min(std::max(overlap, 0.0f), 0.95f);
+
+	for (int i = 0; i < channels.size(); i++) {
+		auto welch = channels[i]->welch_block;
+
+		if (welch) {
+			welch->set_overlap(welch_overlap);
+			welch->set_nb_averages(welchAverages());
+		}
+	}
+}
+
 void SpectrumAnalyzer::build_gnuradio_block_chain_no_ctx()
 {
 	// TO DO: don't use the 100e6 hardcoded value anymore
 	fft_sink = adiscope::scope_sink_f::make(fft_size, 100e6,
 			"Osc Frequency", num_adc_channels,
 			(QObject *)fft_plot);
+	fft_sink->set_float_frames(true);
 
 	top_block = gr::make_top_block("spectrum_analyzer");
 
 	for (int i = 0; i < num_adc_channels; i++) {
-		auto fft = gnuradio::get_initial_sptr(
-				new fft_block(false, fft_size));
-		auto ctm = gr::blocks::complex_to_mag_squared::make(1);
+		auto fft = channel_fft_block(i, false);
 
 		auto siggen = gr::analog::sig_source_f::make(100e6,
 			gr::analog::GR_SIN_WAVE, 5e6 + i * 5e6, 2048);
@@ -431,13 +719,12 @@ void SpectrumAnalyzer::build_gnuradio_block_chain_no_ctx()
 		auto add = gr::blocks::add_ff::make();
 
 		//siggen->|
-		//        |->add->fft->ctm->fft_sink
+		//        |->add->fft(i)->fft_sink
 		//noise-->|
 		top_block->connect(siggen, 0, add, 0);
 		top_block->connect(noise, 0, add, 1);
-		top_block->connect(add, 0, fft, 0);
-		top_block->connect(fft, 0, ctm, 0);
-		top_block->connect(ctm, 0, fft_sink, i);
+		top_block->connect(add, 0, fft, i);
+		top_block->connect(fft, i, fft_sink, i);
 
 		channels[i]->fft_block = fft;
 	}
@@ -499,7 +786,8 @@ void SpectrumAnalyzer::on_comboBox_window_currentIndexChanged(const QString& s)
 		return;
 	}
 
-	if (!channels[crt_channel]->fft_block)
+	if (!channels[crt_channel]->fft_block &&
+			!channels[crt_channel]->welch_block)
 		return;
 	auto win_type = (*it).second;
 	if (win_type != channels[crt_channel]->fftWindow())
@@ -570,6 +858,9 @@ void SpectrumAnalyzer::onChannelSelected(bool en)
 		}
 
 		updateCrtMrkLblVisibility();
+
+		if (waterfall_blk)
+			waterfall_blk->set_channel(chIdx);
 	}
 
 	crt_channel_id = chIdx;
@@ -623,6 +914,7 @@ void SpectrumAnalyzer::onStartStopChanged()
 	fft_plot->replot();
 
 	setSampleRate(2 * stop);
+	updateZoom();
 
 	/* Re-populate the RBW list with the new available values */
 	ui->cmb_rbw->blockSignals(true);
@@ -630,7 +922,8 @@ void SpectrumAnalyzer::onStartStopChanged()
 	int i = 0;
 	for (; i < bin_sizes.size(); i++) {
 		ui->cmb_rbw->addItem(freq_formatter.format(
-		sample_rate / bin_sizes[i], "Hz", 2));
+		sample_rate / zoomDecimation(bin_sizes[i]) / bin_sizes[i],
+		"Hz", 2));
 	}
 	ui->cmb_rbw->blockSignals(false);
 	ui->cmb_rbw->setCurrentIndex(i - 1);
@@ -679,6 +972,8 @@ void SpectrumAnalyzer::onCenterSpanChanged()
 	// Configure plot
 	fft_plot->setAxisScale(QwtPlot::xBottom, start, stop);
 	fft_plot->replot();
+
+	updateZoom();
 }
 
 void SpectrumAnalyzer::writeAllSettingsToHardware()
@@ -773,48 +1068,28 @@ void SpectrumAnalyzer::setSampleRate(double sr)
 			adc->setSampleRate(sr);
 		}
 
-		fft_plot->presetSampleRate(new_sr);
+		fft_plot->presetSampleRate(new_sr / zoom_decimation);
 		fft_plot->resetAverageHistory();
-		fft_sink->set_samp_rate(new_sr);
+		fft_sink->set_samp_rate(new_sr / zoom_decimation);
 
 		start_blockchain_flow();
 	}
 	sample_rate = new_sr;
+
+	for (int i = 0; i < channels.size(); i++)
+		if (channels[i]->welch_block)
+			channels[i]->welch_block->set_nb_averages(
+				welchAverages());
 }
 
 void SpectrumAnalyzer::setFftSize(uint size)
 {
-	// TO DO: This is cumbersome. We shouldn't have to rebuild the entire
-	//        block chain every time we need to change the FFT size. A
-	//        spectrum_sink block similar to scope_sink_f would be better
-
-	bool started = iio->started();
-
-	if (started)
-		iio->lock();
-
 	fft_size = size;
 	fft_sink->set_nsamps(size);
-	for (int i = 0; i < channels.size(); i++) {
-		auto fft = gnuradio::get_initial_sptr(
-			new fft_block(false, size));
+	zoom_decimation = zoomDecimation(size);
 
-		iio->disconnect(fft_ids[i]);
-		fft_ids[i] = iio->connect(fft, i, 0, true, size);
-		iio->connect(fft, 0, channels[i]->ctm_block, 0);
-		iio->connect(channels[i]->ctm_block, 0, fft_sink, i);
-
-		if (started)
-			iio->start(fft_ids[i]);
-
-		channels[i]->fft_block = fft;
-		channels[i]->setFftWindow(channels[i]->fftWindow(), size);
-
-		iio->set_buffer_size(fft_ids[i], size);
-	}
-
-	if (started)
-		iio->unlock();
+	rebuild_channel_chains();
+	updateZoom();
 }
 
 void SpectrumAnalyzer::on_btnPrevMrk_clicked()
@@ -1102,8 +1377,16 @@ void SpectrumChannel::setAverageType(FftDisplayPlot::AverageType avg_type)
 
 void SpectrumChannel::setFftWindow(SpectrumAnalyzer::FftWinType win, int taps)
 {
+	auto window = build_win(win, taps);
+
 	m_fft_win = win;
-	fft_block->set_window(build_win(win, taps));
+
+	if (fft_block)
+		fft_block->set_window(window, m_id);
+	if (welch_block)
+		welch_block->set_window(window);
+
+	m_plot->setMeasureWindow(m_id, *window, win_lobe_bins(win));
 }
 
 SpectrumAnalyzer::FftWinType SpectrumChannel::fftWindow() const
@@ -1138,26 +1421,159 @@ void SpectrumChannel::onSettingsBtnToggled(bool en)
 	Q_EMIT settingsToggled(en);
 }
 
-std::vector<float> SpectrumChannel::build_win(SpectrumAnalyzer::FftWinType type,
-		int ntaps)
+/* Half width of the main lobe of each window, in bins */
+unsigned int SpectrumChannel::win_lobe_bins(SpectrumAnalyzer::FftWinType type)
 {
 	switch(type) {
 		case SpectrumAnalyzer::FLAT_TOP:
-			return gr::fft::window::flattop(ntaps);
+			return 5;
+		case SpectrumAnalyzer::BLACKMAN_HARRIS:
+			return 4;
+		case SpectrumAnalyzer::TRIANGULAR:
+		case SpectrumAnalyzer::HAMMING:
+		case SpectrumAnalyzer::HANN:
+			return 2;
 		case SpectrumAnalyzer::RECTANGULAR:
-			return gr::fft::window::rectangular(ntaps);
+		case SpectrumAnalyzer::KAISER:
+		default:
+			return 1;
+	}
+}
+
+fft_plan_cache::window_sptr SpectrumChannel::build_win(
+		SpectrumAnalyzer::FftWinType type, int ntaps)
+{
+	using gr::fft::window;
+
+	switch(type) {
+		case SpectrumAnalyzer::FLAT_TOP:
+			return fft_plan_cache::get_window(window::WIN_FLATTOP,
+					ntaps);
 		case SpectrumAnalyzer::TRIANGULAR:
-			return gr::fft::window::bartlett(ntaps);
+			return fft_plan_cache::get_window(window::WIN_BARTLETT,
+					ntaps);
 		case SpectrumAnalyzer::HAMMING:
-			return gr::fft::window::hamming(ntaps);
+			return fft_plan_cache::get_window(window::WIN_HAMMING,
+					ntaps);
 		case SpectrumAnalyzer::HANN:
-			return gr::fft::window::hann(ntaps);
+			return fft_plan_cache::get_window(window::WIN_HANN,
+					ntaps);
 		case SpectrumAnalyzer::BLACKMAN_HARRIS:
-			return gr::fft::window::blackman_harris(ntaps);
+			return fft_plan_cache::get_window(
+					window::WIN_BLACKMAN_hARRIS, ntaps);
 		case SpectrumAnalyzer::KAISER:
-			return gr::fft::window::kaiser(ntaps, 0);
+			return fft_plan_cache::get_window(window::WIN_KAISER,
+					ntaps, 0);
+		case SpectrumAnalyzer::RECTANGULAR:
 		default:
-			std::vector<float> v(ntaps, 1.0);
-			return v;
+			return fft_plan_cache::get_window(
+					window::WIN_RECTANGULAR, ntaps);
 	}
 }
+
+/*
+ * class SpectrumAnalyzer_API
+ */
+bool SpectrumAnalyzer_API::welch() const
+{
+	return sp->welch_enabled;
+}
+
+void SpectrumAnalyzer_API::setWelch(bool en)
+{
+	sp->setWelch(en);
+}
+
+double SpectrumAnalyzer_API::welchOverlap() const
+{
+	return sp->welch_overlap;
+}
+
+void SpectrumAnalyzer_API::setWelchOverlap(double overlap)
+{
+	sp->setWelchOverlap(overlap);
+}
+
+bool SpectrumAnalyzer_API::zoom() const
+{
+	return sp->zoom_enabled;
+}
+
+void SpectrumAnalyzer_API::setZoom(bool en)
+{
+	sp->setZoom(en);
+}
+
+bool SpectrumAnalyzer_API::waterfall() const
+{
+	return sp->waterfall_enabled;
+}
+
+void SpectrumAnalyzer_API::setWaterfall(bool en)
+{
+	sp->setWaterfall(en);
+}
+
+bool SpectrumAnalyzer_API::measure() const
+{
+	return sp->fft_plot->measureEnabled();
+}
+
+void SpectrumAnalyzer_API::setMeasure(bool en)
+{
+	sp->fft_plot->setMeasureEnabled(en);
+}
+
+int SpectrumAnalyzer_API::measureHarmonics() const
+{
+	return sp->fft_plot->measureHarmonics();
+}
+
+void SpectrumAnalyzer_API::setMeasureHarmonics(int count)
+{
+	sp->fft_plot->setMeasureHarmonics(std::max(count, 0));
+}
+
+QList<double> SpectrumAnalyzer_API::measureBand() const
+{
+	double start, stop;
+
+	sp->fft_plot->measureBand(start, stop);
+	return QList<double>() << start << stop;
+}
+
+void SpectrumAnalyzer_API::setMeasureBand(const QList<double>& band)
+{
+	if (band.size() == 2)
+		sp->fft_plot->setMeasureBand(band[0], band[1]);
+}
+
+QVariantMap SpectrumAnalyzer_API::measurements(int chIdx) const
+{
+	QVariantMap map;
+
+	if (chIdx < 0 || chIdx >= sp->num_adc_channels)
+		return map;
+
+	const SpectralMeasurements& res = sp->fft_plot->measurements(chIdx);
+	if (!res.valid)
+		return map;
+
+	QVariantList harmonics;
+	for (double h : res.harmonics)
+		harmonics.push_back(h);
+
+	map["fundamental_freq"] = sp->fft_plot->frequencyAtPos(
+			res.fundamental_bin);
+	map["fundamental"] = res.fundamental;
+	map["harmonics"] = harmonics;
+	map["thd"] = res.thd;
+	map["snr"] = res.snr;
+	map["sinad"] = res.sinad;
+	map["sfdr"] = res.sfdr;
+	map["enob"] = res.enob;
+	map["noise_floor"] = res.noise_floor;
+	map["band_power"] = res.band_power;
+
+	return map;
+}
@@ -22,17 +22,20 @@
 
 #include <gnuradio/top_block.h>
 #include <gnuradio/fft/window.h>
-#include <gnuradio/blocks/complex_to_mag_squared.h>
+#include <gnuradio/filter/freq_xlating_fir_filter_fcc.h>
 
 #include "apiObject.hpp"
 #include "iio_manager.hpp"
 #include "scope_sink_f.h"
 #include "fft_block.hpp"
+#include "welch_psd.hpp"
+#include "waterfall_display.hpp"
 #include "FftDisplayPlot.h"
 #include "osc_adc.h"
 #include "tool.hpp"
 #include "plot_utils.hpp"
 
+#include <QVariantMap>
 #include <QWidget>
 
 extern "C" {
@@ -127,6 +130,21 @@ private:
 	int channelIdOfOpenedSettings() const;
 	void setSampleRate(double sr);
 	void setFftSize(uint size);
+	void setWelch(bool en);
+	void setWelchOverlap(float overlap);
+	unsigned int welchAverages() const;
+	void setZoom(bool en);
+	void setWaterfall(bool en);
+	void updateWaterfallRange();
+	unsigned int zoomDecimation(uint fft_size) const;
+	static std::vector<float> zoom_filter_taps(unsigned int decim);
+	static size_t zoom_settle_length(const std::vector<float>& taps,
+			unsigned int decim);
+	void updateZoom();
+	void connect_channel_chain(int chIdx);
+	boost::shared_ptr<adiscope::fft_block> channel_fft_block(int chIdx,
+			bool use_complex);
+	void rebuild_channel_chains();
 	void setMarkerEnabled(int ch_idx, int mrk_idx, bool en);
 	void setActiveMarker(int mrk_idx);
 	void setCurrentMarkerLabelData(int chIdx, int mkIdx);
@@ -144,6 +162,7 @@ private:
 	QList<channel_sptr> channels;
 
 	adiscope::scope_sink_f::sptr fft_sink;
+	boost::shared_ptr<adiscope::fft_block> shared_fft;
 	iio_manager::port_id *fft_ids;
 
 	boost::shared_ptr<iio_manager> iio;
@@ -159,6 +178,26 @@ private:
 	int sample_rate_divider;
 	uint fft_size;
 	QList<uint> bin_sizes;
+
+	/* Streaming mode: many overlapped FFTs are averaged per update */
+	bool welch_enabled;
+	float welch_overlap;
+	static const unsigned long WELCH_BUFFER_SIZE = 1 << 18;
+	static constexpr double WELCH_UPDATE_PERIOD = 0.1;
+
+	/* Zoom mode: the span is mixed down to baseband and decimated
+	 * before the FFT. The usable part of the decimated band is limited
+	 * by the transition band of the decimation filter. */
+	bool zoom_enabled;
+	unsigned int zoom_decimation;
+	static const unsigned long ZOOM_MAX_BUFFER_SIZE = 1 << 20;
+	static constexpr double ZOOM_USABLE_BANDWIDTH = 0.8;
+
+	bool waterfall_enabled;
+	WaterfallBuffer::sptr waterfall_buffer;
+	WaterfallDisplay *waterfall;
+	waterfall_sink::sptr waterfall_blk;
+	static const unsigned int WATERFALL_ROWS = 512;
 	MetricPrefixFormatter freq_formatter;
 
 	QList<QPushButton *> mrk_buttons;
@@ -176,7 +215,8 @@ Q_OBJECT
 
 public:
 	boost::shared_ptr<adiscope::fft_block> fft_block;
-	gr::blocks::complex_to_mag_squared::sptr ctm_block;
+	boost::shared_ptr<adiscope::welch_psd> welch_block;
+	gr::filter::freq_xlating_fir_filter_fcc::sptr ddc_block;
 	QWidget *m_widget;
 	Ui::Channel *m_ui;
 
@@ -223,19 +263,55 @@ private:
 	SpectrumAnalyzer::FftWinType m_fft_win;
 	FftDisplayPlot *m_plot;
 
-	static std::vector<float> build_win(SpectrumAnalyzer::FftWinType type,
-		int ntaps);
+	static adiscope::fft_plan_cache::window_sptr build_win(
+		SpectrumAnalyzer::FftWinType type, int ntaps);
+	static unsigned int win_lobe_bins(SpectrumAnalyzer::FftWinType type);
 };
 
 class SpectrumAnalyzer_API : public ApiObject
 {
 	Q_OBJECT
 
+	Q_PROPERTY(bool welch READ welch WRITE setWelch)
+	Q_PROPERTY(double welch_overlap
+			READ welchOverlap WRITE setWelchOverlap)
+	Q_PROPERTY(bool zoom READ zoom WRITE setZoom)
+	Q_PROPERTY(bool waterfall READ waterfall WRITE setWaterfall)
+	Q_PROPERTY(bool measure READ measure WRITE setMeasure)
+	Q_PROPERTY(int measure_harmonics
+			READ measureHarmonics WRITE setMeasureHarmonics)
+	Q_PROPERTY(QList<double> measure_band
+			READ measureBand WRITE setMeasureBand)
+
 public:
 	explicit SpectrumAnalyzer_API(SpectrumAnalyzer *sp) :
 		ApiObject(), sp(sp) {}
 	~SpectrumAnalyzer_API() {}
 
+	bool welch() const;
+	void setWelch(bool en);
+
+	double welchOverlap() const;
+	void setWelchOverlap(double overlap);
+
+	bool zoom() const;
+	void setZoom(bool en);
+
+	bool waterfall() const;
+	void setWaterfall(bool en);
+
+	bool measure() const;
+	void setMeasure(bool en);
+
+	int measureHarmonics() const;
+	void setMeasureHarmonics(int count);
+
+	QList<double> measureBand() const;
+	void setMeasureBand(const QList<double>& band);
+
+	/* Latest measurements of a channel; empty if there are none */
+	Q_INVOKABLE QVariantMap measurements(int chIdx) const;
+
 private:
 	SpectrumAnalyzer *sp;
 };
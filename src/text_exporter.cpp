@@ -0,0 +1,322 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "text_exporter.hpp"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QPointer>
+#include <QProgressDialog>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string.h>
+
+using namespace adiscope;
+
+const uint64_t TextExporter::ROWS_PER_BLOCK;
+
+static const double pow10_table[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* Scale by 10^n; exact for the powers of ten that a double can hold */
+static inline double scale_pow10(double value, int n)
+{
+	return n >= 0 ? value * pow10_table[n] : value / pow10_table[-n];
+}
+
+TextBuffer::TextBuffer() :
+	d_buf(4096),
+	d_size(0)
+{
+}
+
+void TextBuffer::clear()
+{
+	d_size = 0;
+}
+
+const char *TextBuffer::data() const
+{
+	return d_buf.data();
+}
+
+size_t TextBuffer::size() const
+{
+	return d_size;
+}
+
+char *TextBuffer::reserve(size_t len)
+{
+	if (d_size + len > d_buf.size())
+		d_buf.resize(2 * (d_size + len));
+
+	return &d_buf[d_size];
+}
+
+void TextBuffer::append(char c)
+{
+	*reserve(1) = c;
+	d_size++;
+}
+
+void TextBuffer::append(const char *str, size_t len)
+{
+	memcpy(reserve(len), str, len);
+	d_size += len;
+}
+
+void TextBuffer::appendUInt(uint64_t value)
+{
+	char tmp[20];
+	int len = 0;
+
+	do {
+		tmp[len++] = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	char *p = reserve(len);
+	for (int i = 0; i < len; i++)
+		p[i] = tmp[len - 1 - i];
+	d_size += len;
+}
+
+void TextBuffer::appendDouble(double value)
+{
+	char *p = reserve(32);
+	char *start = p;
+
+	if (value == 0.0) {
+		*p++ = '0';
+		d_size += p - start;
+		return;
+	}
+
+	double mag = std::fabs(value);
+	int exp10 = 0;
+
+	if (std::isfinite(value))
+		exp10 = (int)std::floor(std::log10(mag));
+
+	// Only the common range is handled here, everything else (including
+	// inf and nan) goes through printf
+	if (!std::isfinite(value) || exp10 < -16 || exp10 > 16) {
+		d_size += snprintf(p, 32, "%g", value);
+		return;
+	}
+
+	uint64_t digits = (uint64_t)std::llround(scale_pow10(mag, 5 - exp10));
+
+	// log10() may be off by one right next to a power of ten, and the
+	// rounding may carry into a seventh digit
+	if (digits < 100000) {
+		exp10--;
+		digits = (uint64_t)std::llround(scale_pow10(mag, 5 - exp10));
+	}
+	if (digits >= 1000000) {
+		exp10++;
+		digits = (uint64_t)std::llround(scale_pow10(mag, 5 - exp10));
+	}
+
+	char d[6];
+	for (int i = 5; i >= 0; i--) {
+		d[i] = '0' + digits % 10;
+		digits /= 10;
+	}
+
+	int nb_digits = 6;
+	while (nb_digits > 1 && d[nb_digits - 1] == '0')
+		nb_digits--;
+
+	if (value < 0)
+		*p++ = '-';
+
+	if (exp10 < -4 || exp10 >= 6) {
+		*p++ = d[0];
+		if (nb_digits > 1) {
+			*p++ = '.';
+			for (int i = 1; i < nb_digits; i++)
+				*p++ = d[i];
+		}
+
+		int e = exp10 < 0 ? -exp10 : exp10;
+		*p++ = 'e';
+		*p++ = exp10 < 0 ? '-' : '+';
+		if (e >= 10)
+			*p++ = '0' + e / 10;
+		else
+			*p++ = '0';
+		*p++ = '0' + e % 10;
+	} else if (exp10 < 0) {
+		*p++ = '0';
+		*p++ = '.';
+		for (int i = 1; i < -exp10; i++)
+			*p++ = '0';
+		for (int i = 0; i < nb_digits; i++)
+			*p++ = d[i];
+	} else {
+		for (int i = 0; i <= exp10; i++)
+			*p++ = d[i];
+		if (nb_digits > exp10 + 1) {
+			*p++ = '.';
+			for (int i = exp10 + 1; i < nb_digits; i++)
+				*p++ = d[i];
+		}
+	}
+
+	d_size += p - start;
+}
+
+TextExporter::TextExporter(QObject *parent) :
+	QObject(parent),
+	d_cancel(false)
+{
+}
+
+TextExporter::~TextExporter()
+{
+	cancel();
+	wait();
+}
+
+bool TextExporter::start(const QString& filename, const QByteArray& header,
+		uint64_t nb_rows, BlockFormatter formatter, bool append)
+{
+	if (d_future.isRunning())
+		return false;
+
+	d_cancel = false;
+	d_future = QtConcurrent::run(this, &TextExporter::run, filename,
+			header, nb_rows, formatter, append);
+	return true;
+}
+
+void TextExporter::wait()
+{
+	d_future.waitForFinished();
+}
+
+void TextExporter::cancel()
+{
+	d_cancel = true;
+}
+
+void TextExporter::run(QString filename, QByteArray header, uint64_t nb_rows,
+		BlockFormatter formatter, bool append)
+{
+	QFile file(filename);
+	QIODevice::OpenMode mode = QIODevice::WriteOnly |
+		(append ? QIODevice::Append : QIODevice::Truncate);
+
+	if (!file.open(mode)) {
+		Q_EMIT finished(false);
+		return;
+	}
+
+	QElapsedTimer timer;
+	TextBuffer buf;
+	bool ok = file.write(header) == header.size();
+	qint64 written = header.size();
+	int last_percent = -1;
+
+	timer.start();
+
+	for (uint64_t row = 0; ok && row < nb_rows; row += ROWS_PER_BLOCK) {
+		if (d_cancel) {
+			ok = false;
+			break;
+		}
+
+		uint64_t count = std::min(ROWS_PER_BLOCK, nb_rows - row);
+
+		buf.clear();
+		formatter(buf, row, count);
+
+		ok = file.write(buf.data(), buf.size()) == (qint64)buf.size();
+		written += buf.size();
+
+		int percent = (row + count) * 100 / nb_rows;
+		if (percent != last_percent) {
+			last_percent = percent;
+			Q_EMIT progress(percent);
+		}
+	}
+
+	file.close();
+
+	double seconds = timer.elapsed() / 1000.0;
+	if (ok && seconds > 0)
+		qDebug() << "Exported" << written << "bytes to" << filename
+			<< "at" << written / seconds / 1e6 << "MB/s";
+
+	Q_EMIT finished(ok);
+}
+
+bool TextExporter::exportWithProgress(QWidget *parent,
+		const QString& filename, const QByteArray& header,
+		uint64_t nb_rows, BlockFormatter formatter, bool append)
+{
+	TextExporter exporter;
+	QEventLoop loop;
+	bool success = false;
+
+	/*
+	 * The dialog blocks the input to the whole application right away,
+	 * so that nothing can start another export or close the tool while
+	 * this one runs. It lives on the heap as its parent may still be
+	 * deleted meanwhile (e.g. on device disconnect), which cancels the
+	 * export.
+	 */
+	QPointer<QProgressDialog> dialog = new QProgressDialog(
+			tr("Exporting..."), tr("Cancel"), 0, 100, parent);
+
+	dialog->setWindowModality(Qt::ApplicationModal);
+	dialog->setMinimumDuration(0);
+
+	connect(&exporter, &TextExporter::progress,
+			dialog.data(), &QProgressDialog::setValue);
+	connect(dialog.data(), &QProgressDialog::canceled,
+			&exporter, &TextExporter::cancel);
+	connect(dialog.data(), &QObject::destroyed,
+			&exporter, &TextExporter::cancel);
+	connect(&exporter, &TextExporter::finished, &loop, [&](bool ok) {
+		success = ok;
+		loop.quit();
+	});
+
+	if (!exporter.start(filename, header, nb_rows, formatter, append)) {
+		delete dialog;
+		return false;
+	}
+
+	dialog->show();
+	loop.exec();
+	exporter.wait();
+
+	delete dialog;
+
+	return success;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef TEXT_EXPORTER_HPP
+#define TEXT_EXPORTER_HPP
+
+#include <QByteArray>
+#include <QFuture>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class QWidget;
+
+namespace adiscope {
+
+	/*
+	 * Growable character buffer with number formatting that avoids the
+	 * locale and allocation overhead of QString::number / QTextStream.
+	 */
+	class TextBuffer
+	{
+	public:
+		TextBuffer();
+
+		void clear();
+		const char *data() const;
+		size_t size() const;
+
+		void append(char c);
+		void append(const char *str, size_t len);
+		void appendUInt(uint64_t value);
+
+		/* Formatted like printf("%g"), i.e. 6 significant digits */
+		void appendDouble(double value);
+
+	private:
+		char *reserve(size_t len);
+
+		std::vector<char> d_buf;
+		size_t d_size;
+	};
+
+	/*
+	 * Writes a delimited text file from a worker thread. The rows are
+	 * produced in blocks by a formatter callback into a reusable buffer,
+	 * and each block is written to the file in one go.
+	 */
+	class TextExporter : public QObject
+	{
+		Q_OBJECT
+
+	public:
+		/* Appends the rows [first, first + count) to the buffer */
+		typedef std::function<void(TextBuffer& buf, uint64_t first,
+				uint64_t count)> BlockFormatter;
+
+		static const uint64_t ROWS_PER_BLOCK = 16384;
+
+		explicit TextExporter(QObject *parent = nullptr);
+		~TextExporter();
+
+		bool start(const QString& filename, const QByteArray& header,
+				uint64_t nb_rows, BlockFormatter formatter,
+				bool append = false);
+		void wait();
+
+		/*
+		 * Runs an export while showing an application modal progress
+		 * dialog that can cancel it. Returns true if the file was
+		 * completely written. The parent may be deleted before this
+		 * returns, callers must check before touching it again.
+		 */
+		static bool exportWithProgress(QWidget *parent,
+				const QString& filename,
+				const QByteArray& header, uint64_t nb_rows,
+				BlockFormatter formatter, bool append = false);
+
+	public Q_SLOTS:
+		void cancel();
+
+	Q_SIGNALS:
+		void progress(int percent);
+		void finished(bool success);
+
+	private:
+		void run(QString filename, QByteArray header, uint64_t nb_rows,
+				BlockFormatter formatter, bool append);
+
+		QFuture<void> d_future;
+		std::atomic<bool> d_cancel;
+	};
+}
+
+#endif /* TEXT_EXPORTER_HPP */
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "waterfall_display.hpp"
+
+#include <QImage>
+#include <QPainter>
+
+using namespace adiscope;
+
+WaterfallDisplay::WaterfallDisplay(WaterfallBuffer::sptr buffer,
+		QWidget *parent) :
+	QWidget(parent),
+	m_buffer(buffer),
+	m_rows_painted(0),
+	m_start(0.0),
+	m_stop(1.0)
+{
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setMinimumHeight(100);
+
+	m_timer.setInterval(REFRESH_PERIOD_MS);
+	connect(&m_timer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+void WaterfallDisplay::setVisibleRange(double start, double stop)
+{
+	m_start = qBound(0.0, start, 1.0);
+	m_stop = qBound(m_start, stop, 1.0);
+	update();
+}
+
+void WaterfallDisplay::showEvent(QShowEvent *)
+{
+	m_timer.start();
+}
+
+void WaterfallDisplay::hideEvent(QHideEvent *)
+{
+	m_timer.stop();
+}
+
+void WaterfallDisplay::refresh()
+{
+	if (m_buffer->rowsWritten() != m_rows_painted)
+		update();
+}
+
+void WaterfallDisplay::paintEvent(QPaintEvent *)
+{
+	QPainter p(this);
+	std::unique_lock<std::mutex> lock(m_buffer->mutex());
+
+	unsigned int columns = m_buffer->columns();
+	unsigned int rows = m_buffer->rows();
+	unsigned int head = m_buffer->head();
+
+	m_rows_painted = m_buffer->rowsWritten();
+
+	/* Wraps the ring without copying it */
+	QImage image((const uchar *)m_buffer->pixels(), columns, rows,
+			columns * sizeof(uint32_t), QImage::Format_RGB32);
+
+	double x = m_start * columns;
+	double w = (m_stop - m_start) * columns;
+	double scale = (double)height() / rows;
+
+	/* The rows from the head down to the end of the ring are the
+	 * newest ones; the ring then wraps around to its first row */
+	QRectF newest_src(x, head, w, rows - head);
+	QRectF newest_dst(0, 0, width(), (rows - head) * scale);
+	QRectF oldest_src(x, 0, w, head);
+	QRectF oldest_dst(0, newest_dst.bottom(), width(), head * scale);
+
+	p.drawImage(newest_dst, image, newest_src);
+	if (head)
+		p.drawImage(oldest_dst, image, oldest_src);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef WATERFALL_DISPLAY_HPP
+#define WATERFALL_DISPLAY_HPP
+
+#include <QTimer>
+#include <QWidget>
+
+#include "waterfall_sink.hpp"
+
+namespace adiscope {
+
+	/*
+	 * Paints a WaterfallBuffer, newest row at the top. It refreshes at a
+	 * fixed rate and only when new rows came in, however fast they are
+	 * produced.
+	 */
+	class WaterfallDisplay : public QWidget
+	{
+		Q_OBJECT
+
+	public:
+		static const int REFRESH_PERIOD_MS = 33;
+
+		explicit WaterfallDisplay(WaterfallBuffer::sptr buffer,
+				QWidget *parent = nullptr);
+
+		/* Part of the rows to show, as fractions of their width */
+		void setVisibleRange(double start, double stop);
+
+	protected:
+		void paintEvent(QPaintEvent *event);
+		void showEvent(QShowEvent *event);
+		void hideEvent(QHideEvent *event);
+
+	private Q_SLOTS:
+		void refresh();
+
+	private:
+		WaterfallBuffer::sptr m_buffer;
+		QTimer m_timer;
+		uint64_t m_rows_painted;
+		double m_start;
+		double m_stop;
+	};
+}
+
+#endif /* WATERFALL_DISPLAY_HPP */
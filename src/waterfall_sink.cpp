@@ -0,0 +1,236 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "waterfall_sink.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
+using namespace adiscope;
+
+const unsigned int waterfall_sink::MAX_COLUMNS;
+
+WaterfallBuffer::WaterfallBuffer(unsigned int columns, unsigned int rows) :
+	d_columns(columns),
+	d_rows(rows),
+	d_head(0),
+	d_min_db(-160.0f),
+	d_max_db(0.0f),
+	d_rows_written(0)
+{
+	buildColorMap();
+	clear();
+}
+
+/* Black to blue to red to yellow to white, like a heat map */
+void WaterfallBuffer::buildColorMap()
+{
+	static const struct {
+		float pos;
+		int r, g, b;
+	} stops[] = {
+		{ 0.00f,   0,   0,   0 },
+		{ 0.25f,   0,   0, 200 },
+		{ 0.50f, 200,   0, 120 },
+		{ 0.75f, 255, 160,   0 },
+		{ 1.00f, 255, 255, 255 },
+	};
+
+	for (int i = 0; i < 256; i++) {
+		float pos = i / 255.0f;
+		unsigned int s = 1;
+
+		while (s < 4 && stops[s].pos < pos)
+			s++;
+
+		float t = (pos - stops[s - 1].pos) /
+			(stops[s].pos - stops[s - 1].pos);
+		int r = stops[s - 1].r + t * (stops[s].r - stops[s - 1].r);
+		int g = stops[s - 1].g + t * (stops[s].g - stops[s - 1].g);
+		int b = stops[s - 1].b + t * (stops[s].b - stops[s - 1].b);
+
+		d_color_map[i] = 0xff000000u | (r << 16) | (g << 8) | b;
+	}
+}
+
+void WaterfallBuffer::clear()
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	reset();
+}
+
+/* Must be called with the buffer locked */
+void WaterfallBuffer::reset()
+{
+	d_pixels.assign((size_t)d_columns * d_rows, d_color_map[0]);
+	d_index.resize(d_columns);
+	d_head = 0;
+	d_rows_written = 0;
+}
+
+void WaterfallBuffer::setRange(float min_db, float max_db)
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	d_min_db = min_db;
+	d_max_db = std::max(max_db, min_db + 1.0f);
+}
+
+void WaterfallBuffer::appendRow(const float *level, unsigned int columns)
+{
+	std::unique_lock<std::mutex> lock(d_mutex);
+
+	if (columns != d_columns) {
+		d_columns = columns;
+		reset();
+	}
+
+	float scale = 255.0f / (d_max_db - d_min_db);
+	float offset = -d_min_db * scale;
+
+	/* Straight-line code that the compiler turns into SIMD; only the
+	 * table lookup is done one pixel at a time */
+	for (unsigned int i = 0; i < columns; i++) {
+		float v = level[i] * scale + offset;
+
+		v = std::min(std::max(v, 0.0f), 255.0f);
+		d_index[i] = (int32_t)v;
+	}
+
+	/* New rows go upwards, so that the ring read from the head on is
+	 * ordered from the newest to the oldest row */
+	d_head = d_head ? d_head - 1 : d_rows - 1;
+
+	uint32_t *row = &d_pixels[(size_t)d_head * d_columns];
+	for (unsigned int i = 0; i < columns; i++)
+		row[i] = d_color_map[d_index[i]];
+
+	d_rows_written++;
+}
+
+std::mutex& WaterfallBuffer::mutex()
+{
+	return d_mutex;
+}
+
+const uint32_t *WaterfallBuffer::pixels() const
+{
+	return d_pixels.data();
+}
+
+unsigned int WaterfallBuffer::columns() const
+{
+	return d_columns;
+}
+
+unsigned int WaterfallBuffer::rows() const
+{
+	return d_rows;
+}
+
+unsigned int WaterfallBuffer::head() const
+{
+	return d_head;
+}
+
+uint64_t WaterfallBuffer::rowsWritten() const
+{
+	return d_rows_written;
+}
+
+waterfall_sink::waterfall_sink(unsigned int nb_channels, size_t fft_size,
+		WaterfallBuffer::sptr buffer) :
+	gr::sync_block("waterfall_sink",
+			gr::io_signature::make(nb_channels, nb_channels,
+				sizeof(float)),
+			gr::io_signature::make(0, 0, 0)),
+	d_nb_channels(nb_channels),
+	d_fft_size(fft_size),
+	d_buffer(buffer),
+	d_channel(0),
+	d_full_spectrum(false),
+	d_row(fft_size)
+{
+	set_output_multiple(fft_size);
+}
+
+void waterfall_sink::set_channel(unsigned int chn)
+{
+	if (chn < d_nb_channels)
+		d_channel = chn;
+}
+
+void waterfall_sink::set_full_spectrum(bool en)
+{
+	d_full_spectrum = en;
+}
+
+void waterfall_sink::process_frame(const float *in)
+{
+	size_t nb_bins = d_fft_size;
+	float *row = d_row.data();
+
+	if (d_full_spectrum) {
+		/* Put the negative frequencies first */
+		size_t neg = d_fft_size / 2;
+
+		std::copy(in + d_fft_size - neg, in + d_fft_size, row);
+		std::copy(in, in + d_fft_size - neg, row + neg);
+	} else {
+		nb_bins = d_fft_size / 2;
+		std::copy(in, in + nb_bins, row);
+	}
+
+	/* Keep the highest bin of each column */
+	size_t columns = std::min<size_t>(nb_bins, MAX_COLUMNS);
+	size_t bins_per_column = nb_bins / columns;
+
+	if (bins_per_column > 1) {
+		for (size_t c = 0; c < columns; c++)
+			row[c] = *std::max_element(row + c * bins_per_column,
+					row + (c + 1) * bins_per_column);
+	}
+
+	/* Same dB full-scale as the spectrum plot */
+	float full_scale = 20 * log10(2048.0 * nb_bins);
+
+	volk_32f_log2_32f(row, row, columns);
+	volk_32f_s32f_multiply_32f(row, row, 10 * log10(2.0), columns);
+	for (size_t c = 0; c < columns; c++)
+		row[c] -= full_scale;
+
+	d_buffer->appendRow(row, columns);
+}
+
+int waterfall_sink::work(int noutput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	const float *in = (const float *)input_items[d_channel];
+
+	for (size_t i = 0; i + d_fft_size <= (size_t)noutput_items;
+			i += d_fft_size)
+		process_frame(in + i);
+
+	return noutput_items;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef WATERFALL_SINK_HPP
+#define WATERFALL_SINK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <gnuradio/sync_block.h>
+
+namespace adiscope {
+
+	/*
+	 * Ring of color-mapped spectrum rows, written by the waterfall sink
+	 * and painted by the waterfall display. The rows are stored newest
+	 * first from the write position and wrap around, so the display
+	 * scrolls by drawing the two halves of the ring at an offset instead
+	 * of moving any pixels.
+	 */
+	class WaterfallBuffer
+	{
+	public:
+		typedef boost::shared_ptr<WaterfallBuffer> sptr;
+
+		WaterfallBuffer(unsigned int columns, unsigned int rows);
+
+		/* Color-maps one row of levels in dB and adds it to the ring.
+		 * The buffer is cleared if the number of columns changed. */
+		void appendRow(const float *level, unsigned int columns);
+
+		void setRange(float min_db, float max_db);
+		void clear();
+
+		/* Hold the lock while reading the pixels */
+		std::mutex& mutex();
+		const uint32_t *pixels() const;
+		unsigned int columns() const;
+		unsigned int rows() const;
+
+		/* Row holding the newest data */
+		unsigned int head() const;
+		uint64_t rowsWritten() const;
+
+	private:
+		void buildColorMap();
+		void reset();
+
+		std::mutex d_mutex;
+		std::vector<uint32_t> d_pixels;
+		std::vector<int32_t> d_index;
+		uint32_t d_color_map[256];
+
+		unsigned int d_columns;
+		unsigned int d_rows;
+		unsigned int d_head;
+		float d_min_db, d_max_db;
+
+		std::atomic<uint64_t> d_rows_written;
+	};
+
+	/*
+	 * Turns each spectrum frame (squared magnitudes of fft_size bins, as
+	 * produced by fft_block) of the selected channel into one waterfall
+	 * row. Every frame is kept, independently of the display refresh
+	 * rate. Large FFTs are reduced to at most MAX_COLUMNS columns, each
+	 * one holding the highest bin it covers, so narrow spurs remain
+	 * visible.
+	 */
+	class waterfall_sink : public gr::sync_block
+	{
+	public:
+		typedef boost::shared_ptr<waterfall_sink> sptr;
+
+		static const unsigned int MAX_COLUMNS = 2048;
+
+		waterfall_sink(unsigned int nb_channels, size_t fft_size,
+				WaterfallBuffer::sptr buffer);
+
+		void set_channel(unsigned int chn);
+
+		/* The frames hold a complex spectrum in FFT order, instead of
+		 * the mirrored spectrum of a real signal */
+		void set_full_spectrum(bool en);
+
+		int work(int noutput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		void process_frame(const float *in);
+
+		unsigned int d_nb_channels;
+		size_t d_fft_size;
+		WaterfallBuffer::sptr d_buffer;
+		std::atomic<unsigned int> d_channel;
+		std::atomic<bool> d_full_spectrum;
+		std::vector<float> d_row;
+	};
+}
+
+#endif /* WATERFALL_SINK_HPP */
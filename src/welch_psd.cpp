@@ -0,0 +1,175 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "welch_psd.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+#include <gnuradio/fft/window.h>
+#include <gnuradio/io_signature.h>
+#include <volk/volk.h>
+
+using namespace adiscope;
+
+welch_psd::welch_psd(size_t fft_size, float overlap,
+		unsigned int nb_averages) :
+	gr::block("welch_psd",
+			gr::io_signature::make(1, 1, sizeof(float)),
+			gr::io_signature::make(1, 1, sizeof(float))),
+	d_fft_size(fft_size),
+	d_nb_bins(fft_size / 2 + 1),
+	d_nb_averages(std::max(nb_averages, 1u)),
+	d_tag_key(pmt::intern("buffer_start")),
+	d_fft(fft_plan_cache::get_real(fft_size)),
+	d_window(fft_plan_cache::get_window(gr::fft::window::WIN_HAMMING,
+				fft_size)),
+	d_fill(0),
+	d_count(0)
+{
+	size_t align = volk_get_alignment();
+
+	d_segment = (float *)volk_malloc(fft_size * sizeof(float), align);
+	d_magnitude = (float *)volk_malloc(d_nb_bins * sizeof(float), align);
+	d_sum = (float *)volk_malloc(d_nb_bins * sizeof(float), align);
+	memset(d_sum, 0, d_nb_bins * sizeof(float));
+
+	set_overlap(overlap);
+
+	/* The input tags don't map to anything in the output frames */
+	set_tag_propagation_policy(TPP_DONT);
+	set_output_multiple(fft_size);
+}
+
+welch_psd::~welch_psd()
+{
+	volk_free(d_segment);
+	volk_free(d_magnitude);
+	volk_free(d_sum);
+}
+
+void welch_psd::set_window(fft_plan_cache::window_sptr window)
+{
+	gr::thread::scoped_lock lock(d_setlock);
+
+	if (window && window->size() == d_fft_size)
+		d_window = window;
+}
+
+void welch_psd::set_overlap(float overlap)
+{
+	gr::thread::scoped_lock lock(d_setlock);
+
+	overlap = std::min(std::max(overlap, 0.0f), 0.95f);
+	d_hop = std::max<size_t>(1, d_fft_size * (1.0f - overlap));
+
+	/* Start over with a fresh segment */
+	d_fill = 0;
+}
+
+void welch_psd::set_nb_averages(unsigned int nb_averages)
+{
+	gr::thread::scoped_lock lock(d_setlock);
+
+	d_nb_averages = std::max(nb_averages, 1u);
+}
+
+void welch_psd::process_segment()
+{
+	volk_32f_x2_multiply_32f(d_fft->get_inbuf(), d_segment,
+			d_window->data(), d_fft_size);
+	d_fft->execute();
+
+	volk_32fc_magnitude_squared_32f(d_magnitude, d_fft->get_outbuf(),
+			d_nb_bins);
+	volk_32f_x2_add_32f(d_sum, d_sum, d_magnitude, d_nb_bins);
+	d_count++;
+
+	/* Keep the overlapping part for the next segment */
+	memmove(d_segment, d_segment + d_hop,
+			(d_fft_size - d_hop) * sizeof(float));
+	d_fill = d_fft_size - d_hop;
+}
+
+void welch_psd::write_frame(float *out)
+{
+	volk_32f_s32f_multiply_32f(out, d_sum, 1.0f / d_count, d_nb_bins);
+
+	for (size_t i = d_nb_bins; i < d_fft_size; i++)
+		out[i] = out[d_fft_size - i];
+
+	add_item_tag(0, nitems_written(0), d_tag_key, pmt::PMT_T);
+
+	memset(d_sum, 0, d_nb_bins * sizeof(float));
+	d_count = 0;
+}
+
+int welch_psd::general_work(int noutput_items,
+		gr_vector_int &ninput_items,
+		gr_vector_const_void_star &input_items,
+		gr_vector_void_star &output_items)
+{
+	gr::thread::scoped_lock lock(d_setlock);
+
+	const float *in = (const float *)input_items[0];
+	float *out = (float *)output_items[0];
+	uint64_t nread = nitems_read(0);
+	size_t nb_in = ninput_items[0];
+	size_t consumed = 0;
+	int produced = 0;
+
+	std::vector<gr::tag_t> tags;
+	get_tags_in_range(tags, 0, nread, nread + nb_in, d_tag_key);
+	std::sort(tags.begin(), tags.end(), gr::tag_t::offset_compare);
+	auto tag = tags.begin();
+
+	while (consumed < nb_in && produced + d_fft_size <=
+			(size_t)noutput_items) {
+		uint64_t offset = nread + consumed;
+
+		/* A new buffer starts here: drop the partial segment */
+		if (tag != tags.end() && tag->offset == offset) {
+			d_fill = 0;
+			++tag;
+		}
+
+		size_t count = std::min(nb_in - consumed,
+				d_fft_size - d_fill);
+		if (tag != tags.end())
+			count = std::min<size_t>(count, tag->offset - offset);
+
+		memcpy(d_segment + d_fill, in + consumed,
+				count * sizeof(float));
+		d_fill += count;
+		consumed += count;
+
+		if (d_fill < d_fft_size)
+			continue;
+
+		process_segment();
+
+		if (d_count == d_nb_averages) {
+			write_frame(out + produced);
+			produced += d_fft_size;
+		}
+	}
+
+	consume_each(consumed);
+	return produced;
+}
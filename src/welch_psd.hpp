@@ -0,0 +1,81 @@
+/*
+ * Copyright 2016 Analog Devices, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file LICENSE.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef WELCH_PSD_HPP
+#define WELCH_PSD_HPP
+
+#include <vector>
+
+#include <gnuradio/block.h>
+
+#include "fft_plan_cache.hpp"
+
+namespace adiscope {
+	/*
+	 * Streaming power spectrum estimate using Welch's method: the input
+	 * is cut in overlapping segments of fft_size samples, each segment
+	 * is windowed and transformed, and the squared magnitudes of
+	 * nb_averages consecutive segments are averaged into one output
+	 * frame of fft_size bins.
+	 *
+	 * A segment never spans two acquisition buffers, since the samples
+	 * on both sides of a "buffer_start" tag are not contiguous. Each
+	 * output frame starts with a "buffer_start" tag, so the frames can
+	 * be picked up by a sink triggering on that tag just like the ones
+	 * of a plain FFT chain. The output is scaled like the squared
+	 * magnitude of a single FFT, and the bins above fft_size / 2 mirror
+	 * the ones below, as they would for a real signal.
+	 */
+	class welch_psd : public gr::block
+	{
+	public:
+		welch_psd(size_t fft_size, float overlap,
+				unsigned int nb_averages);
+		~welch_psd();
+
+		void set_window(fft_plan_cache::window_sptr window);
+		void set_overlap(float overlap);
+		void set_nb_averages(unsigned int nb_averages);
+
+		int general_work(int noutput_items,
+				gr_vector_int &ninput_items,
+				gr_vector_const_void_star &input_items,
+				gr_vector_void_star &output_items);
+
+	private:
+		void process_segment();
+		void write_frame(float *out);
+
+		size_t d_fft_size;
+		size_t d_nb_bins;
+		size_t d_hop;
+		unsigned int d_nb_averages;
+		pmt::pmt_t d_tag_key;
+
+		fft_plan_cache::real_sptr d_fft;
+		fft_plan_cache::window_sptr d_window;
+		float *d_segment;
+		float *d_magnitude;
+		float *d_sum;
+		size_t d_fill;
+		unsigned int d_count;
+	};
+}
+
+#endif /* WELCH_PSD_HPP */